@@ -31,6 +31,16 @@
  * improvements over the original code were made.
  */
 
+#if !defined(OUTPUT_UNSIGNED_AUDIO)
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RATE_SIMD
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define RATE_SIMD
+#endif
+#endif
+
 #include "audio/audiostream.h"
 #include "audio/rate.h"
 #include "audio/mixer.h"
@@ -49,6 +59,108 @@ namespace Audio {
 #define INTERMEDIATE_BUFFER_SIZE 512
 
 
+#ifdef RATE_SIMD
+
+/**
+ * Scale 4 sample pairs by the volumes in vol and add them to obuf with
+ * saturation. The division rounds towards zero, like the scalar
+ * (sample * vol) / kMaxMixerVolume, so the result is the same as four
+ * clampedAdd() calls per channel.
+ */
+#if defined(__SSE2__)
+static inline void mixPairs4(st_sample_t *obuf, __m128i in, __m128i vol) {
+	const __m128i round = _mm_set1_epi32(Audio::Mixer::kMaxMixerVolume - 1);
+	__m128i lo = _mm_mullo_epi16(in, vol);
+	__m128i hi = _mm_mulhi_epi16(in, vol);
+	__m128i p0 = _mm_unpacklo_epi16(lo, hi);
+	__m128i p1 = _mm_unpackhi_epi16(lo, hi);
+	p0 = _mm_srai_epi32(_mm_add_epi32(p0, _mm_and_si128(_mm_srai_epi32(p0, 31), round)), 8);
+	p1 = _mm_srai_epi32(_mm_add_epi32(p1, _mm_and_si128(_mm_srai_epi32(p1, 31), round)), 8);
+	__m128i out = _mm_loadu_si128((const __m128i *)obuf);
+	_mm_storeu_si128((__m128i *)obuf, _mm_adds_epi16(out, _mm_packs_epi32(p0, p1)));
+}
+#else
+static inline void mixPairs4(st_sample_t *obuf, int16x8_t in, int16x8_t vol) {
+	const int32x4_t round = vdupq_n_s32(Audio::Mixer::kMaxMixerVolume - 1);
+	int32x4_t p0 = vmull_s16(vget_low_s16(in), vget_low_s16(vol));
+	int32x4_t p1 = vmull_s16(vget_high_s16(in), vget_high_s16(vol));
+	p0 = vshrq_n_s32(vaddq_s32(p0, vandq_s32(vshrq_n_s32(p0, 31), round)), 8);
+	p1 = vshrq_n_s32(vaddq_s32(p1, vandq_s32(vshrq_n_s32(p1, 31), round)), 8);
+	int16x8_t out = vld1q_s16(obuf);
+	vst1q_s16(obuf, vqaddq_s16(out, vcombine_s16(vqmovn_s32(p0), vqmovn_s32(p1))));
+}
+#endif
+
+#endif
+
+/**
+ * Add count sample pairs, built from ibuf and scaled by the channel
+ * volumes, to obuf. ibuf holds interleaved pairs for stereo input and
+ * single samples otherwise.
+ */
+template<bool stereo, bool reverseStereo>
+static void mixSamples(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t count, st_volume_t vol_l, st_volume_t vol_r) {
+#ifdef RATE_SIMD
+	// the kernels multiply 16 bit lanes, volumes are never louder than this
+	if (vol_l <= Audio::Mixer::kMaxMixerVolume && vol_r <= Audio::Mixer::kMaxMixerVolume) {
+		// with reversed stereo the left volume goes to the right output
+		int16 v0 = reverseStereo ? vol_r : vol_l;
+		int16 v1 = reverseStereo ? vol_l : vol_r;
+#if defined(__SSE2__)
+		const __m128i vol = _mm_set_epi16(v1, v0, v1, v0, v1, v0, v1, v0);
+		for (; count >= 4; count -= 4) {
+			__m128i in;
+			if (stereo) {
+				in = _mm_loadu_si128((const __m128i *)ibuf);
+				if (reverseStereo)
+					in = _mm_shufflehi_epi16(_mm_shufflelo_epi16(in, 0xB1), 0xB1);
+				ibuf += 8;
+			} else {
+				in = _mm_loadl_epi64((const __m128i *)ibuf);
+				in = _mm_unpacklo_epi16(in, in);
+				ibuf += 4;
+			}
+			mixPairs4(obuf, in, vol);
+			obuf += 8;
+		}
+#else
+		const int16 vols[8] = { v0, v1, v0, v1, v0, v1, v0, v1 };
+		const int16x8_t vol = vld1q_s16(vols);
+		for (; count >= 4; count -= 4) {
+			int16x8_t in;
+			if (stereo) {
+				in = vld1q_s16(ibuf);
+				if (reverseStereo)
+					in = vrev32q_s16(in);
+				ibuf += 8;
+			} else {
+				int16x4x2_t dup = vzip_s16(vld1_s16(ibuf), vld1_s16(ibuf));
+				in = vcombine_s16(dup.val[0], dup.val[1]);
+				ibuf += 4;
+			}
+			mixPairs4(obuf, in, vol);
+			obuf += 8;
+		}
+#endif
+	}
+#endif
+
+	for (; count > 0; count--) {
+		st_sample_t out0, out1;
+		out0 = *ibuf++;
+		out1 = (stereo ? *ibuf++ : out0);
+
+		// output left channel
+		clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
+
+		// output right channel
+		clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+
+		obuf += 2;
+	}
+}
+
+
 /**
  * Audio rate converter based on simple resampling. Used when no
  * interpolation is required.
@@ -59,6 +171,8 @@ template<bool stereo, bool reverseStereo>
 class SimpleRateConverter : public RateConverter {
 protected:
 	st_sample_t inBuf[INTERMEDIATE_BUFFER_SIZE];
+	/** resampled pairs waiting to be mixed into the output */
+	st_sample_t outBuf[INTERMEDIATE_BUFFER_SIZE];
 	const st_sample_t *inPtr;
 	int inLen;
 
@@ -105,10 +219,11 @@ SimpleRateConverter<stereo, reverseStereo>::SimpleRateConverter(st_rate_t inrate
  */
 template<bool stereo, bool reverseStereo>
 int SimpleRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
-	st_sample_t *ostart, *oend;
+	st_sample_t *ostart, *oend, *outPtr;
 
 	ostart = obuf;
 	oend = obuf + osamp * 2;
+	outPtr = outBuf;
 
 	while (obuf < oend) {
 
@@ -118,8 +233,10 @@ int SimpleRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_samp
 			if (inLen == 0) {
 				inPtr = inBuf;
 				inLen = input.readBuffer(inBuf, ARRAYSIZE(inBuf));
-				if (inLen <= 0)
+				if (inLen <= 0) {
+					mixSamples<true, reverseStereo>(obuf - (outPtr - outBuf), outBuf, (outPtr - outBuf) / 2, vol_l, vol_r);
 					return (obuf - ostart) / 2;
+				}
 			}
 			inLen -= (stereo ? 2 : 1);
 			opos--;
@@ -135,14 +252,16 @@ int SimpleRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_samp
 		// Increment output position
 		opos += opos_inc;
 
-		// output left channel
-		clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
-
-		// output right channel
-		clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
-
+		*outPtr++ = out0;
+		*outPtr++ = out1;
 		obuf += 2;
+
+		if (outPtr == outBuf + ARRAYSIZE(outBuf)) {
+			mixSamples<true, reverseStereo>(obuf - ARRAYSIZE(outBuf), outBuf, ARRAYSIZE(outBuf) / 2, vol_l, vol_r);
+			outPtr = outBuf;
+		}
 	}
+	mixSamples<true, reverseStereo>(obuf - (outPtr - outBuf), outBuf, (outPtr - outBuf) / 2, vol_l, vol_r);
 	return (obuf - ostart) / 2;
 }
 
@@ -161,6 +280,8 @@ template<bool stereo, bool reverseStereo>
 class LinearRateConverter : public RateConverter {
 protected:
 	st_sample_t inBuf[INTERMEDIATE_BUFFER_SIZE];
+	/** resampled pairs waiting to be mixed into the output */
+	st_sample_t outBuf[INTERMEDIATE_BUFFER_SIZE];
 	const st_sample_t *inPtr;
 	int inLen;
 
@@ -214,10 +335,11 @@ LinearRateConverter<stereo, reverseStereo>::LinearRateConverter(st_rate_t inrate
  */
 template<bool stereo, bool reverseStereo>
 int LinearRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
-	st_sample_t *ostart, *oend;
+	st_sample_t *ostart, *oend, *outPtr;
 
 	ostart = obuf;
 	oend = obuf + osamp * 2;
+	outPtr = outBuf;
 
 	while (obuf < oend) {
 
@@ -227,8 +349,10 @@ int LinearRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_samp
 			if (inLen == 0) {
 				inPtr = inBuf;
 				inLen = input.readBuffer(inBuf, ARRAYSIZE(inBuf));
-				if (inLen <= 0)
+				if (inLen <= 0) {
+					mixSamples<true, reverseStereo>(obuf - (outPtr - outBuf), outBuf, (outPtr - outBuf) / 2, vol_l, vol_r);
 					return (obuf - ostart) / 2;
+				}
 			}
 			inLen -= (stereo ? 2 : 1);
 			ilast0 = icur0;
@@ -250,18 +374,20 @@ int LinearRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_samp
 						  (st_sample_t)(ilast1 + (((icur1 - ilast1) * opos + FRAC_HALF) >> FRAC_BITS)) :
 						  out0);
 
-			// output left channel
-			clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
-
-			// output right channel
-			clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
-
+			*outPtr++ = out0;
+			*outPtr++ = out1;
 			obuf += 2;
 
+			if (outPtr == outBuf + ARRAYSIZE(outBuf)) {
+				mixSamples<true, reverseStereo>(obuf - ARRAYSIZE(outBuf), outBuf, ARRAYSIZE(outBuf) / 2, vol_l, vol_r);
+				outPtr = outBuf;
+			}
+
 			// Increment output position
 			opos += opos_inc;
 		}
 	}
+	mixSamples<true, reverseStereo>(obuf - (outPtr - outBuf), outBuf, (outPtr - outBuf) / 2, vol_l, vol_r);
 	return (obuf - ostart) / 2;
 }
 
@@ -285,7 +411,6 @@ public:
 	virtual int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
 		assert(input.isStereo() == stereo);
 
-		st_sample_t *ptr;
 		st_size_t len;
 
 		st_sample_t *ostart = obuf;
@@ -304,20 +429,10 @@ public:
 		len = input.readBuffer(_buffer, osamp);
 
 		// Mix the data into the output buffer
-		ptr = _buffer;
-		for (; len > 0; len -= (stereo ? 2 : 1)) {
-			st_sample_t out0, out1;
-			out0 = *ptr++;
-			out1 = (stereo ? *ptr++ : out0);
-
-			// output left channel
-			clampedAdd(obuf[reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
-
-			// output right channel
-			clampedAdd(obuf[reverseStereo ^ 1], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
-
-			obuf += 2;
-		}
+		if (stereo)
+			len /= 2;
+		mixSamples<stereo, reverseStereo>(obuf, _buffer, len, vol_l, vol_r);
+		obuf += len * 2;
 		return (obuf - ostart) / 2;
 	}
 
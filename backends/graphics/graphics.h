@@ -47,6 +47,7 @@ public:
 	virtual int16 getHeight() = 0;
 	virtual int16 getWidth() = 0;
 	virtual void updateScreen() = 0;
+	virtual void updateScreenRects(const Common::List<Common::Rect> &rects) = 0;
 
 	virtual void showOverlay() = 0;
 	virtual void hideOverlay() = 0;
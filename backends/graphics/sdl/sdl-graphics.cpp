@@ -325,6 +325,37 @@ void SdlGraphicsManager::updateScreen() {
 	}
 }
 
+void SdlGraphicsManager::updateScreenRects(const Common::List<Common::Rect> &rects) {
+	// the overlay and the GL path always redraw the whole screen
+#ifdef USE_OPENGL
+	if (_opengl) {
+		updateScreen();
+		return;
+	}
+#endif
+	if (_overlayVisible || rects.empty()) {
+		updateScreen();
+		return;
+	}
+
+	SDL_Rect *sdlRects = new SDL_Rect[rects.size()];
+	int count = 0;
+	for (Common::List<Common::Rect>::const_iterator i = rects.begin(); i != rects.end(); ++i) {
+		Common::Rect r = *i;
+		r.clip(_screen->w, _screen->h);
+		if (r.isEmpty())
+			continue;
+		sdlRects[count].x = r.left;
+		sdlRects[count].y = r.top;
+		sdlRects[count].w = r.width();
+		sdlRects[count].h = r.height();
+		count++;
+	}
+	if (count)
+		SDL_UpdateRects(_screen, count, sdlRects);
+	delete[] sdlRects;
+}
+
 int16 SdlGraphicsManager::getHeight() {
 	return _screen->h;
 }
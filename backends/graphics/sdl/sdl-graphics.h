@@ -61,6 +61,7 @@ public:
 
 public:
 	virtual void updateScreen();
+	virtual void updateScreenRects(const Common::List<Common::Rect> &rects);
 
 	virtual void showOverlay();
 	virtual void hideOverlay();
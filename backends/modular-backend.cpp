@@ -102,6 +102,10 @@ void ModularBackend::updateScreen() {
 	_graphicsManager->updateScreen();
 }
 
+void ModularBackend::updateScreenRects(const Common::List<Common::Rect> &rects) {
+	_graphicsManager->updateScreenRects(rects);
+}
+
 void ModularBackend::showOverlay() {
 	_graphicsManager->showOverlay();
 }
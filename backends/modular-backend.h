@@ -75,6 +75,7 @@ public:
 	virtual int16 getHeight();
 	virtual int16 getWidth();
 	virtual void updateScreen();
+	virtual void updateScreenRects(const Common::List<Common::Rect> &rects);
 
 	virtual void showOverlay();
 	virtual void hideOverlay();
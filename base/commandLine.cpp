@@ -122,6 +122,9 @@ void registerDefaults() {
 	ConfMan.registerDefault("fullscreen", false);
 	ConfMan.registerDefault("soft_renderer", "true");
 	ConfMan.registerDefault("show_fps", "false");
+	ConfMan.registerDefault("soft_renderer_tiled", false);
+	ConfMan.registerDefault("soft_renderer_dirty_rects", false);
+	ConfMan.registerDefault("exact_model_bounds", false);
 
 	// Sound & Music
 	ConfMan.registerDefault("music_volume", 127);
@@ -146,6 +149,14 @@ void registerDefaults() {
 
 	ConfMan.registerDefault("dimuse_tempo", 10);
 
+	// Grim resources
+	ConfMan.registerDefault("lab_mmap", true);
+	ConfMan.registerDefault("resource_cache_size", 32 * 1024 * 1024);	// In bytes, 0 means unbounded
+	ConfMan.registerDefault("keyframe_bake", false);
+	ConfMan.registerDefault("lua_task_budget", 0);	// In milliseconds per frame, 0 means unbounded
+	ConfMan.registerDefault("savegame_async", false);
+	ConfMan.registerDefault("imuse_cache_size", 2 * 1024 * 1024);	// In bytes
+
 	// Miscellaneous
 	ConfMan.registerDefault("confirm_exit", false);
 	ConfMan.registerDefault("disable_sdl_parachute", false);
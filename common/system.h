@@ -236,6 +236,15 @@ public:
 	 */
 	virtual void updateScreen() = 0;
 
+	/**
+	 * Flush only the given areas of the screen framebuffer to the display,
+	 * the rest of it being unchanged since the last update. Backends which
+	 * can't update parts of the display flush the whole screen.
+	 *
+	 * @param rects		the areas which changed
+	 */
+	virtual void updateScreenRects(const Common::List<Common::Rect> &rects) { updateScreen(); }
+
 	//@}
 
 
@@ -35,6 +35,9 @@
 namespace Grim {
 
 int Actor::s_id = 0;
+Common::Array<Actor::PathNode> Actor::s_pathNodes;
+Common::Array<int> Actor::s_pathHeap;
+Common::Array<int> Actor::s_sectorNodes;
 
 int g_winX1, g_winY1, g_winX2, g_winY2;
 
@@ -484,6 +487,47 @@ void Actor::turnTo(float pitchParam, float yawParam, float rollParam) {
 		_turning = false;
 }
 
+// The open set is ordered by estimated total cost, then by creation order,
+// which picks the same node as the first cheapest one in a list would.
+bool Actor::pathNodeLess(int a, int b) {
+	float ca = s_pathNodes[a].dist + s_pathNodes[a].cost;
+	float cb = s_pathNodes[b].dist + s_pathNodes[b].cost;
+	return ca < cb || (ca == cb && a < b);
+}
+
+void Actor::pathHeapUp(int pos) {
+	int node = s_pathHeap[pos];
+	while (pos > 0) {
+		int parent = (pos - 1) / 2;
+		if (!pathNodeLess(node, s_pathHeap[parent]))
+			break;
+		s_pathHeap[pos] = s_pathHeap[parent];
+		s_pathNodes[s_pathHeap[pos]].heapPos = pos;
+		pos = parent;
+	}
+	s_pathHeap[pos] = node;
+	s_pathNodes[node].heapPos = pos;
+}
+
+void Actor::pathHeapDown(int pos) {
+	int size = s_pathHeap.size();
+	int node = s_pathHeap[pos];
+	for (;;) {
+		int child = pos * 2 + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size && pathNodeLess(s_pathHeap[child + 1], s_pathHeap[child]))
+			child++;
+		if (!pathNodeLess(s_pathHeap[child], node))
+			break;
+		s_pathHeap[pos] = s_pathHeap[child];
+		s_pathNodes[s_pathHeap[pos]].heapPos = pos;
+		pos = child;
+	}
+	s_pathHeap[pos] = node;
+	s_pathNodes[node].heapPos = pos;
+}
+
 void Actor::walkTo(Graphics::Vector3d p) {
 	if (p == _pos)
 		_walking = false;
@@ -493,46 +537,47 @@ void Actor::walkTo(Graphics::Vector3d p) {
 		_path.clear();
 
 		if (_constrain) {
-			Common::List<PathNode *> openList;
-			Common::List<PathNode *> closedList;
-
-			PathNode *start = new PathNode;
+			Scene *scene = g_grim->currScene();
+			int numSectors = scene->getSectorCount();
+			if (numSectors < 0)
+				numSectors = 0;
+
+			// every sector gets at most one node, plus the start one, so
+			// the pool never grows during the search and parents stay valid
+			s_pathNodes.resize(numSectors + 1);
+			s_pathHeap.clear();
+			s_sectorNodes.resize(numSectors);
+			for (int i = 0; i < numSectors; ++i)
+				s_sectorNodes[i] = -1;
+			int numNodes = 0;
+
+			PathNode *start = &s_pathNodes[numNodes];
 			start->parent = NULL;
 			start->pos = _pos;
 			start->dist = 0.f;
 			start->cost = 0.f;
-			openList.push_back(start);
-			g_grim->currScene()->findClosestSector(_pos, &start->sect, NULL);
-
-			Graphics::Vector3d currPos = _pos;
-			Common::List<Sector *> sectors;
-			for (int i = 0; i < g_grim->currScene()->getSectorCount(); ++i) {
-				Sector *s = g_grim->currScene()->getSectorBase(i);
-				if (s->type() >= Sector::WalkType && s->visible()) {
-					sectors.push_back(s);
-				}
-			}
+			scene->findClosestSector(_pos, &start->sect, NULL);
+			start->sectIndex = scene->getSectorIndex(start->sect);
+			if (start->sectIndex >= 0)
+				s_sectorNodes[start->sectIndex] = numNodes;
+			s_pathHeap.push_back(numNodes++);
+			start->heapPos = 0;
 
 			Sector *endSec = NULL;
-			g_grim->currScene()->findClosestSector(_destPos, &endSec, NULL);
+			scene->findClosestSector(_destPos, &endSec, NULL);
 
 			do {
-				PathNode *node = NULL;
-				float cost = -1.f;
-				for (Common::List<PathNode *>::iterator j = openList.begin(); j != openList.end(); ++j) {
-					PathNode *n = *j;
-					float c = n->dist + n->cost;
-					if (cost < 0.f || c < cost) {
-						cost = c;
-						node = n;
-					}
-				}
-				closedList.push_back(node);
-				openList.remove(node);
+				int nodeIndex = s_pathHeap[0];
+				PathNode *node = &s_pathNodes[nodeIndex];
+				s_pathHeap[0] = s_pathHeap.back();
+				s_pathHeap.pop_back();
+				if (!s_pathHeap.empty())
+					pathHeapDown(0);
+				node->heapPos = -1;
 				Sector *sector = node->sect;
 
 				if (sector == endSec) {
-					PathNode *n = closedList.back()->parent;
+					PathNode *n = node->parent;
 					while (n) {
 						_path.push_back(n->pos);
 						n = n->parent;
@@ -541,48 +586,41 @@ void Actor::walkTo(Graphics::Vector3d p) {
 					break;
 				}
 
-				for (Common::List<Sector *>::iterator i = sectors.begin(); i != sectors.end(); ++i) {
-					Sector *s = *i;
-					bool inClosed = false;
-					for (Common::List<PathNode *>::iterator j = closedList.begin(); j != closedList.end(); ++j) {
-						if ((*j)->sect == s) {
-							inClosed = true;
-							break;
-						}
-					}
-					if (!inClosed && sector->isAdjacentTo(s)) {
-						PathNode *n = NULL;
-						for (Common::List<PathNode *>::iterator j = openList.begin(); j != openList.end(); ++j) {
-							if ((*j)->sect == s) {
-								n = *j;
-								break;
-							}
-						}
-						if (n) {
-							float newCost = node->cost + (n->pos - node->pos).magnitude();
-							if (newCost < n->cost) {
-								n->cost = newCost;
-								n->parent = node;
-							}
-						} else {
-							n = new PathNode;
+				if (node->sectIndex < 0)
+					continue;
+				int numAdjacent;
+				const int *adjacent = scene->getAdjacentSectors(node->sectIndex, &numAdjacent);
+				for (int i = 0; i < numAdjacent; ++i) {
+					Sector *s = scene->getSectorBase(adjacent[i]);
+					if (s->type() < Sector::WalkType || !s->visible())
+						continue;
+
+					int nIndex = s_sectorNodes[adjacent[i]];
+					if (nIndex >= 0) {
+						PathNode *n = &s_pathNodes[nIndex];
+						if (n->heapPos < 0)
+							continue;
+						float newCost = node->cost + (n->pos - node->pos).magnitude();
+						if (newCost < n->cost) {
+							n->cost = newCost;
 							n->parent = node;
-							n->sect = s;
-							n->pos = (s->closestPoint(_destPos) + s->closestPoint(node->pos)) / 2.f;
-							n->dist = (n->pos - _destPos).magnitude();
-							n->cost = node->cost + (n->pos - node->pos).magnitude();
-							openList.push_back(n);
+							pathHeapUp(n->heapPos);
 						}
+					} else {
+						nIndex = numNodes++;
+						PathNode *n = &s_pathNodes[nIndex];
+						n->parent = node;
+						n->sect = s;
+						n->sectIndex = adjacent[i];
+						n->pos = (s->closestPoint(_destPos) + s->closestPoint(node->pos)) / 2.f;
+						n->dist = (n->pos - _destPos).magnitude();
+						n->cost = node->cost + (n->pos - node->pos).magnitude();
+						s_sectorNodes[adjacent[i]] = nIndex;
+						s_pathHeap.push_back(nIndex);
+						pathHeapUp(s_pathHeap.size() - 1);
 					}
 				}
-			} while (!openList.empty());
-
-			for (Common::List<PathNode *>::iterator j = closedList.begin(); j != closedList.end(); ++j) {
-				delete *j;
-			}
-			for (Common::List<PathNode *>::iterator j = openList.begin(); j != openList.end(); ++j) {
-				delete *j;
-			}
+			} while (!s_pathHeap.empty());
 		}
 
 		_path.push_front(_destPos);
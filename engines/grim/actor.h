@@ -250,11 +250,21 @@ private:
 	// struct used for path finding
 	struct PathNode {
 		Sector *sect;
+		int sectIndex;	// index of sect in the scene, -1 if it has none
 		PathNode *parent;
 		Graphics::Vector3d pos;
 		float dist;
 		float cost;
+		int heapPos;	// position in the open set, -1 once closed
 	};
+	// node pool and open set, shared by all the searches
+	static Common::Array<PathNode> s_pathNodes;
+	static Common::Array<int> s_pathHeap;
+	static Common::Array<int> s_sectorNodes;
+
+	static bool pathNodeLess(int a, int b);
+	static void pathHeapUp(int pos);
+	static void pathHeapDown(int pos);
 	Common::List<Graphics::Vector3d> _path;
 
 	friend class GrimEngine;
@@ -24,6 +24,7 @@
  */
 
 #include "common/endian.h"
+#include "common/config-manager.h"
 
 #include "engines/grim/colormap.h"
 #include "engines/grim/costume.h"
@@ -423,6 +424,7 @@ private:
 	int _repeatMode;
 	int _currTime;
 	Common::String _fname;
+	Common::Array<int> _cursors;
 
 	friend class Costume;
 };
@@ -450,6 +452,9 @@ void KeyframeComponent::setKey(int val) {
 			_currTime = -1;
 		}
 		_repeatMode = val;
+		// Looping animations are the ones playing most of the time
+		if (val == 1 && ConfMan.getBool("keyframe_bake"))
+			_keyf->bake();
 		break;
 	case 4:
 		_active = false;
@@ -494,7 +499,12 @@ void KeyframeComponent::update() {
 					warning("Unknown repeat mode %d for keyframe %s", _repeatMode, _keyf->filename());
 		}
 	}
-	_keyf->animate(_hier, _currTime / 1000.0f, _priority1, _priority2);
+	if (_cursors.size() != (uint)_keyf->numJoints()) {
+		_cursors.resize(_keyf->numJoints());
+		for (uint i = 0; i < _cursors.size(); i++)
+			_cursors[i] = 0;
+	}
+	_keyf->animate(_hier, _currTime / 1000.0f, _priority1, _priority2, _cursors.begin());
 }
 
 void KeyframeComponent::init() {
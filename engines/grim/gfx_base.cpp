@@ -23,11 +23,17 @@
  *
  */
 
+#include "common/config-manager.h"
+
 #include "engines/grim/gfx_base.h"
 #include "engines/grim/savegame.h"
 
 namespace Grim {
 
+GfxBase::GfxBase() {
+	_exactModelBounds = ConfMan.getBool("exact_model_bounds");
+}
+
 void GfxBase::saveState(SaveGame *state) {
 	state->beginSection('DRVR');
 
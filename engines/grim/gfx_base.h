@@ -37,7 +37,7 @@ class SaveGame;
 
 class GfxBase {
 public:
-	GfxBase() { ; }
+	GfxBase();
 	virtual ~GfxBase() { ; }
 
 	struct TextObjectHandle {
@@ -75,7 +75,7 @@ public:
 	virtual void translateViewpointFinish() = 0;
 
 	virtual void drawHierachyNode(const Model::HierNode *node) = 0;
-	virtual void drawModelFace(const Model::Face *face, float *vertices, float *vertNormals, float *textureVerts) = 0;
+	virtual void drawModelFaces(const Model::Mesh *mesh, const Model::FaceRun *run) = 0;
 
 	virtual void disableLights() = 0;
 	virtual void setupLight(Scene::Light *light, int lightId) = 0;
@@ -119,6 +119,9 @@ protected:
 	int _screenWidth, _screenHeight, _screenBPP;
 	bool _isFullscreen;
 	Shadow *_currentShadowArray;
+	// Project all the vertices of a mesh for its screen bounds, rather than
+	// the corners of its bounding box
+	bool _exactModelBounds;
 	unsigned char _shadowColorR;
 	unsigned char _shadowColorG;
 	unsigned char _shadowColorB;
@@ -185,34 +185,34 @@ void GfxOpenGL::getBoundingBoxPos(const Model::Mesh *model, int *x1, int *y1, in
 	GLdouble left = 1000;
 	GLdouble bottom = -1000;
 	GLdouble winX, winY, winZ;
+	GLdouble modelView[16], projection[16];
+	GLint viewPort[4];
+
+	glGetDoublev(GL_MODELVIEW_MATRIX, modelView);
+	glGetDoublev(GL_PROJECTION_MATRIX, projection);
+	glGetIntegerv(GL_VIEWPORT, viewPort);
+
+	// Project the corners of the bounding box, or every vertex once
+	const float *points = model->_bounds;
+	int numPoints = model->_numFaces > 0 ? 8 : 0;
+	if (_exactModelBounds && numPoints) {
+		points = model->_vertices;
+		numPoints = model->_numVertices;
+	}
 
-	for (int i = 0; i < model->_numFaces; i++) {
-		Graphics::Vector3d v;
-		float* pVertices;
-
-		for (int j = 0; j < model->_faces[i]._numVertices; j++) {
-			GLdouble modelView[16], projection[16];
-			GLint viewPort[4];
-
-			glGetDoublev(GL_MODELVIEW_MATRIX, modelView);
-			glGetDoublev(GL_PROJECTION_MATRIX, projection);
-			glGetIntegerv(GL_VIEWPORT, viewPort);
-
-			pVertices = model->_vertices + 3 * model->_faces[i]._vertices[j];
-
-			v.set(*(pVertices), *(pVertices + 1), *(pVertices + 2));
+	for (int i = 0; i < numPoints; i++) {
+		const float *pVertices = points + 3 * i;
 
-			gluProject(v.x(), v.y(), v.z(), modelView, projection, viewPort, &winX, &winY, &winZ);
+		gluProject(pVertices[0], pVertices[1], pVertices[2], modelView, projection, viewPort, &winX, &winY, &winZ);
 
-			if (winX > right)
-				right = winX;
-			if (winX < left)
-				left = winX;
-			if (winY < top)
-				top = winY;
-			if (winY > bottom)
-				bottom = winY;
-		}
+		if (winX > right)
+			right = winX;
+		if (winX < left)
+			left = winX;
+		if (winY < top)
+			top = winY;
+		if (winY > bottom)
+			bottom = winY;
 	}
 
 	double t = bottom;
@@ -342,22 +342,26 @@ void GfxOpenGL::set3DMode() {
 	glDepthFunc(GL_LESS);
 }
 
-void GfxOpenGL::drawModelFace(const Model::Face *face, float *vertices, float *vertNormals, float *textureVerts) {
+void GfxOpenGL::drawModelFaces(const Model::Mesh *mesh, const Model::FaceRun *run) {
 	// Support transparency in actor objects, such as the message tube
 	// in Manny's Office
 	glAlphaFunc(GL_GREATER, 0.5);
 	glEnable(GL_ALPHA_TEST);
-	glNormal3fv(face->_normal._coords);
-	glBegin(GL_POLYGON);
-	for (int i = 0; i < face->_numVertices; i++) {
-		glNormal3fv(vertNormals + 3 * face->_vertices[i]);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glVertexPointer(3, GL_FLOAT, 0, mesh->_runVertices);
+	glNormalPointer(GL_FLOAT, 0, mesh->_runNormals);
+	if (run->_textured) {
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		glTexCoordPointer(2, GL_FLOAT, 0, mesh->_runTextureVerts);
+	}
 
-		if (face->_texVertices)
-			glTexCoord2fv(textureVerts + 2 * face->_texVertices[i]);
+	glDrawElements(GL_TRIANGLES, run->_numIndices, GL_UNSIGNED_INT, mesh->_runIndices + run->_firstIndex);
 
-		glVertex3fv(vertices + 3 * face->_vertices[i]);
-	}
-	glEnd();
+	if (run->_textured)
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
 	// Done with transparency-capable objects
 	glDisable(GL_ALPHA_TEST);
 }
@@ -73,7 +73,7 @@ byte *setupScreen(int screenW, int screenH, bool fullscreen);
 	void translateViewpointFinish();
 
 	void drawHierachyNode(const Model::HierNode *node);
-	void drawModelFace(const Model::Face *face, float *vertices, float *vertNormals, float *textureVerts);
+	void drawModelFaces(const Model::Mesh *mesh, const Model::FaceRun *run);
 
 	void disableLights();
 	void setupLight(Scene::Light *light, int lightId);
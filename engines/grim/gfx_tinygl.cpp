@@ -25,6 +25,7 @@
 
 #include "common/endian.h"
 #include "common/system.h"
+#include "common/config-manager.h"
 
 #include "engines/grim/actor.h"
 #include "engines/grim/colormap.h"
@@ -139,10 +140,20 @@ TGLint tgluProject(TGLfloat objx, TGLfloat objy, TGLfloat objz, const TGLfloat m
 GfxTinyGL::GfxTinyGL() {
 	_zb = NULL;
 	_storedDisplay = NULL;
+	_tiledRaster = ConfMan.getBool("soft_renderer_tiled");
+	_dirtyRects = ConfMan.getBool("soft_renderer_dirty_rects");
+	_inBackground = false;
+	_backgroundValid = false;
+	_fullRedraw = false;
+	_untracked = true;
+	_backgroundColor = NULL;
+	_backgroundZ = NULL;
 }
 
 GfxTinyGL::~GfxTinyGL() {
 	delete[] _storedDisplay;
+	delete[] _backgroundColor;
+	delete[] _backgroundZ;
 	if (_zb) {
 		TinyGL::glClose();
 		ZB_close(_zb);
@@ -165,6 +176,11 @@ byte *GfxTinyGL::setupScreen(int screenW, int screenH, bool fullscreen) {
 	_storedDisplay = new byte[640 * 480 * 2];
 	memset(_storedDisplay, 0, 640 * 480 * 2);
 
+	if (_dirtyRects) {
+		_backgroundColor = new byte[640 * 480 * 2];
+		_backgroundZ = new byte[640 * 480 * 2];
+	}
+
 	_currentShadowArray = NULL;
 
 	TGLfloat ambientSource[] = { 0.6f, 0.6f, 0.6f, 1.0f };
@@ -200,13 +216,36 @@ void GfxTinyGL::positionCamera(Graphics::Vector3d pos, Graphics::Vector3d intere
 }
 
 void GfxTinyGL::clearScreen() {
+	if (_dirtyRects) {
+		// the background bitmaps are only recorded until flushBackground()
+		// decides whether they need to be drawn again
+		_inBackground = true;
+		_backgroundDraws.clear();
+		return;
+	}
+
 	memset(_zb->pbuf, 0, 640 * 480 * 2);
 	memset(_zb->zbuf, 0, 640 * 480 * 2);
 	memset(_zb->zbuf2, 0, 640 * 480 * 4);
 }
 
 void GfxTinyGL::flipBuffer() {
-	g_system->updateScreen();
+	if (!_dirtyRects) {
+		g_system->updateScreen();
+		return;
+	}
+
+	if (_inBackground)
+		flushBackground();
+	collectRasterized();
+
+	if (_fullRedraw || _untracked)
+		g_system->updateScreen();
+	else
+		g_system->updateScreenRects(_changedRects);
+
+	_changedRects.clear();
+	_fullRedraw = false;
 }
 
 bool GfxTinyGL::isHardwareAccelerated() {
@@ -276,34 +315,34 @@ void GfxTinyGL::getBoundingBoxPos(const Model::Mesh *model, int *x1, int *y1, in
 	TGLfloat left = 1000;
 	TGLfloat bottom = -1000;
 	TGLfloat winX, winY, winZ;
+	TGLfloat modelView[16], projection[16];
+	TGLint viewPort[4];
+
+	tglGetFloatv(TGL_MODELVIEW_MATRIX, modelView);
+	tglGetFloatv(TGL_PROJECTION_MATRIX, projection);
+	tglGetIntegerv(TGL_VIEWPORT, viewPort);
+
+	// Project the corners of the bounding box, or every vertex once
+	const float *points = model->_bounds;
+	int numPoints = model->_numFaces > 0 ? 8 : 0;
+	if (_exactModelBounds && numPoints) {
+		points = model->_vertices;
+		numPoints = model->_numVertices;
+	}
 
-	for (int i = 0; i < model->_numFaces; i++) {
-		Graphics::Vector3d v;
-		float* pVertices;
-
-		for (int j = 0; j < model->_faces[i]._numVertices; j++) {
-			TGLfloat modelView[16], projection[16];
-			TGLint viewPort[4];
-
-			tglGetFloatv(TGL_MODELVIEW_MATRIX, modelView);
-			tglGetFloatv(TGL_PROJECTION_MATRIX, projection);
-			tglGetIntegerv(TGL_VIEWPORT, viewPort);
-
-			pVertices = model->_vertices + 3 * model->_faces[i]._vertices[j];
-
-			v.set(*(pVertices), *(pVertices + 1), *(pVertices + 2));
+	for (int i = 0; i < numPoints; i++) {
+		const float *pVertices = points + 3 * i;
 
-			tgluProject(v.x(), v.y(), v.z(), modelView, projection, viewPort, &winX, &winY, &winZ);
+		tgluProject(pVertices[0], pVertices[1], pVertices[2], modelView, projection, viewPort, &winX, &winY, &winZ);
 
-			if (winX > right)
-				right = winX;
-			if (winX < left)
-				left = winX;
-			if (winY < top)
-				top = winY;
-			if (winY > bottom)
-				bottom = winY;
-		}
+		if (winX > right)
+			right = winX;
+		if (winX < left)
+			left = winX;
+		if (winY < top)
+			top = winY;
+		if (winY > bottom)
+			bottom = winY;
 	}
 
 	float t = bottom;
@@ -349,6 +388,11 @@ void GfxTinyGL::getBoundingBoxPos(const Model::Mesh *model, int *x1, int *y1, in
 }
 
 void GfxTinyGL::startActorDraw(Graphics::Vector3d pos, float yaw, float pitch, float roll) {
+	if (_inBackground)
+		flushBackground();
+	// actor meshes are binned and rasterized tile by tile until finishActorDraw()
+	if (_tiledRaster)
+		tglEnable(TGL_TILED_RASTER_MODE);
 	tglEnable(TGL_TEXTURE_2D);
 	tglMatrixMode(TGL_MODELVIEW);
 	tglPushMatrix();
@@ -377,6 +421,8 @@ void GfxTinyGL::finishActorDraw() {
 	tglMatrixMode(TGL_MODELVIEW);
 	tglPopMatrix();
 	tglDisable(TGL_TEXTURE_2D);
+	if (_tiledRaster)
+		tglDisable(TGL_TILED_RASTER_MODE);
 
 	if (_currentShadowArray) {
 		tglSetShadowMaskBuf(NULL);
@@ -429,6 +475,8 @@ void GfxTinyGL::clearShadowMode() {
 }
 
 void GfxTinyGL::set3DMode() {
+	if (_inBackground)
+		flushBackground();
 	tglMatrixMode(TGL_MODELVIEW);
 	tglEnable(TGL_DEPTH_TEST);
 }
@@ -453,18 +501,25 @@ void GfxTinyGL::getShadowColor(byte *r, byte *g, byte *b) {
 	*b = _shadowColorB;
 }
 
-void GfxTinyGL::drawModelFace(const Model::Face *face, float *vertices, float *vertNormals, float *textureVerts) {
-	tglNormal3fv(const_cast<float *>(face->_normal._coords));
-	tglBegin(TGL_POLYGON);
-	for (int i = 0; i < face->_numVertices; i++) {
-		tglNormal3fv(vertNormals + 3 * face->_vertices[i]);
+void GfxTinyGL::drawModelFaces(const Model::Mesh *mesh, const Model::FaceRun *run) {
+	tglEnableClientState(TGL_VERTEX_ARRAY);
+	tglEnableClientState(TGL_NORMAL_ARRAY);
+	tglVertexPointer(3, TGL_FLOAT, 0, mesh->_runVertices);
+	tglNormalPointer(TGL_FLOAT, 0, mesh->_runNormals);
+	if (run->_textured) {
+		tglEnableClientState(TGL_TEXTURE_COORD_ARRAY);
+		tglTexCoordPointer(2, TGL_FLOAT, 0, mesh->_runTextureVerts);
+	}
 
-		if (face->_texVertices)
-			tglTexCoord2fv(textureVerts + 2 * face->_texVertices[i]);
+	// The faces are still drawn as polygons, TinyGL lights each vertex
+	// once that way
+	for (int i = run->_firstFace; i < run->_firstFace + run->_numFaces; i++)
+		tglDrawArrays(TGL_POLYGON, mesh->_runFaceStart[i], mesh->_runFaceSize[i]);
 
-		tglVertex3fv(vertices + 3 * face->_vertices[i]);
-	}
-	tglEnd();
+	if (run->_textured)
+		tglDisableClientState(TGL_TEXTURE_COORD_ARRAY);
+	tglDisableClientState(TGL_NORMAL_ARRAY);
+	tglDisableClientState(TGL_VERTEX_ARRAY);
 }
 
 void GfxTinyGL::translateViewpointStart(Graphics::Vector3d pos, float pitch, float yaw, float roll) {
@@ -618,15 +673,102 @@ void TinyGLBlit(byte *dst, byte *src, int x, int y, int width, int height, bool
 
 void GfxTinyGL::drawBitmap(const Bitmap *bitmap) {
 	assert(bitmap->_currImage > 0);
+	if (_inBackground) {
+		BackgroundDraw draw = { bitmap, bitmap->_currImage, bitmap->x(), bitmap->y() };
+		_backgroundDraws.push_back(draw);
+		return;
+	}
 	if (bitmap->_format == 1)
 		TinyGLBlit((byte *)_zb->pbuf, (byte *)bitmap->_data[bitmap->_currImage - 1],
 			bitmap->x(), bitmap->y(), bitmap->width(), bitmap->height(), true);
 	else
 		TinyGLBlit((byte *)_zb->zbuf, (byte *)bitmap->_data[bitmap->_currImage - 1],
 			bitmap->x(), bitmap->y(), bitmap->width(), bitmap->height(), false);
+	addDirtyRect(bitmap->x(), bitmap->y(), bitmap->width(), bitmap->height());
 }
 
-void GfxTinyGL::destroyBitmap(Bitmap *) { }
+void GfxTinyGL::flushBackground() {
+	bool unchanged = _backgroundValid && !_untracked && _backgroundDraws.size() == _lastBackgroundDraws.size();
+
+	_inBackground = false;
+	collectRasterized();
+
+	for (uint i = 0; unchanged && i < _backgroundDraws.size(); i++) {
+		const BackgroundDraw &a = _backgroundDraws[i];
+		const BackgroundDraw &b = _lastBackgroundDraws[i];
+		unchanged = a.bitmap == b.bitmap && a.image == b.image && a.x == b.x && a.y == b.y;
+	}
+
+	if (unchanged) {
+		// only what was drawn over the background since the last frame has to go
+		for (Common::List<Common::Rect>::iterator i = _drawnRects.begin(); i != _drawnRects.end(); ++i) {
+			Common::Rect r = *i;
+			r.clip(640, 480);
+			if (r.isEmpty())
+				continue;
+			for (int y = r.top; y < r.bottom; y++) {
+				int offset = y * 640 + r.left;
+				memcpy(_zb->pbuf + offset, _backgroundColor + offset * 2, r.width() * 2);
+				memcpy(_zb->zbuf + offset, _backgroundZ + offset * 2, r.width() * 2);
+				memset(_zb->zbuf2 + offset, 0, r.width() * 4);
+			}
+			_changedRects.push_back(r);
+		}
+		_drawnRects.clear();
+		return;
+	}
+
+	memset(_zb->pbuf, 0, 640 * 480 * 2);
+	memset(_zb->zbuf, 0, 640 * 480 * 2);
+	memset(_zb->zbuf2, 0, 640 * 480 * 4);
+	for (uint i = 0; i < _backgroundDraws.size(); i++) {
+		const BackgroundDraw &d = _backgroundDraws[i];
+		const Bitmap *bitmap = d.bitmap;
+		if (bitmap->_format == 1)
+			TinyGLBlit((byte *)_zb->pbuf, (byte *)bitmap->_data[d.image - 1], d.x, d.y, bitmap->width(), bitmap->height(), true);
+		else
+			TinyGLBlit((byte *)_zb->zbuf, (byte *)bitmap->_data[d.image - 1], d.x, d.y, bitmap->width(), bitmap->height(), false);
+	}
+	memcpy(_backgroundColor, _zb->pbuf, 640 * 480 * 2);
+	memcpy(_backgroundZ, _zb->zbuf, 640 * 480 * 2);
+
+	_lastBackgroundDraws = _backgroundDraws;
+	_backgroundValid = true;
+	_untracked = false;
+	_fullRedraw = true;
+	_drawnRects.clear();
+	_changedRects.clear();
+}
+
+void GfxTinyGL::addDirtyRect(int x, int y, int width, int height) {
+	if (!_dirtyRects || _untracked)
+		return;
+	_drawnRects.push_back(Common::Rect(x, y, x + width, y + height));
+	_changedRects.push_back(Common::Rect(x, y, x + width, y + height));
+}
+
+void GfxTinyGL::collectRasterized() {
+	if (_zb->dirty_x1 < _zb->dirty_x2 && _zb->dirty_y1 < _zb->dirty_y2)
+		addDirtyRect(_zb->dirty_x1, _zb->dirty_y1, _zb->dirty_x2 - _zb->dirty_x1, _zb->dirty_y2 - _zb->dirty_y1);
+	TinyGL::ZB_resetDirty(_zb);
+}
+
+// The screen was changed in a way the dirty rects don't describe: present it
+// whole and draw the background from scratch on the next frame.
+void GfxTinyGL::markUntracked() {
+	if (!_dirtyRects)
+		return;
+	if (_inBackground)
+		flushBackground();
+	_untracked = true;
+	_drawnRects.clear();
+	_changedRects.clear();
+}
+
+void GfxTinyGL::destroyBitmap(Bitmap *) {
+	// a new bitmap could get the same address and pass for it
+	_backgroundValid = false;
+}
 
 void GfxTinyGL::drawDepthBitmap(int, int, int, int, char *) { }
 
@@ -684,6 +826,7 @@ void GfxTinyGL::prepareSmushFrame(int width, int height, byte *bitmap) {
 }
 
 void GfxTinyGL::drawSmushFrame(int offsetX, int offsetY) {
+	markUntracked();
 	if (_smushWidth == 640 && _smushHeight == 480) {
 		memcpy(_zb->pbuf, _smushBitmap, 640 * 480 * 2);
 	} else {
@@ -700,6 +843,10 @@ void GfxTinyGL::loadEmergFont() {
 void GfxTinyGL::drawEmergString(int x, int y, const char *text, const Color &fgColor) {
 	uint16 color = ((fgColor.red() & 0xF8) << 8) | ((fgColor.green() & 0xFC) << 3) | (fgColor.blue() >> 3);
 
+	if (_inBackground)
+		flushBackground();
+	addDirtyRect(x, y, strlen(text) * 10, 13);
+
 	for (int l = 0; l < (int)strlen(text); l++) {
 		int c = text[l];
 		assert(c >= 32 && c <= 127);
@@ -755,6 +902,9 @@ GfxBase::TextObjectHandle *GfxTinyGL::createTextBitmap(uint8 *data, int width, i
 }
 
 void GfxTinyGL::drawTextBitmap(int x, int y, TextObjectHandle *handle) {
+	if (_inBackground)
+		flushBackground();
+	addDirtyRect(x, y, handle->width, handle->height);
 	TinyGLBlit((byte *)_zb->pbuf, (byte *)handle->bitmapData, x, y, handle->width, handle->height, true);
 }
 
@@ -795,10 +945,13 @@ Bitmap *GfxTinyGL::getScreenshot(int w, int h) {
 }
 
 void GfxTinyGL::storeDisplay() {
+	if (_inBackground)
+		flushBackground();
 	memcpy(_storedDisplay, _zb->pbuf, 640 * 480 * 2);
 }
 
 void GfxTinyGL::copyStoredToDisplay() {
+	markUntracked();
 	memcpy(_zb->pbuf, _storedDisplay, 640 * 480 * 2);
 }
 
@@ -815,6 +968,9 @@ void GfxTinyGL::dimScreen() {
 }
 
 void GfxTinyGL::dimRegion(int x, int y, int w, int h, float level) {
+	if (_inBackground)
+		flushBackground();
+	addDirtyRect(x, y, w, h);
 	uint16 *data = (uint16 *)_zb->pbuf;
 	for (int ly = y; ly < y + h; ly++) {
 		for (int lx = x; lx < x + w; lx++) {
@@ -838,6 +994,10 @@ void GfxTinyGL::drawRectangle(PrimitiveObject *primitive) {
 	Color color = primitive->getColor();
 	uint16 c = ((color.red() & 0xF8) << 8) | ((color.green() & 0xFC) << 3) | (color.blue() >> 3);
 
+	if (_inBackground)
+		flushBackground();
+	addDirtyRect(x1, y1, x2 - x1 + 1, y2 - y1 + 1);
+
 	if (primitive->isFilled()) {
 		for (; y1 <= y2; y1++)
 			if (y1 >= 0 && y1 < 480)
@@ -865,6 +1025,9 @@ void GfxTinyGL::drawRectangle(PrimitiveObject *primitive) {
 }
 
 void GfxTinyGL::drawLine(PrimitiveObject *primitive) {
+	// the slopes are rounded, the pixels may leave the bounding box of the points
+	markUntracked();
+
 	uint16 *dst = (uint16 *)_zb->pbuf;
 	int x1 = primitive->getP1().x;
 	int y1 = primitive->getP1().y;
@@ -891,6 +1054,9 @@ void GfxTinyGL::drawLine(PrimitiveObject *primitive) {
 }
 
 void GfxTinyGL::drawPolygon(PrimitiveObject *primitive) {
+	// the slopes are rounded, the pixels may leave the bounding box of the points
+	markUntracked();
+
 	uint16 *dst = (uint16 *)_zb->pbuf;
 	int x1 = primitive->getP1().x;
 	int y1 = primitive->getP1().y;
@@ -26,6 +26,10 @@
 #ifndef GRIM_GFX_TINYGL_H
 #define GRIM_GFX_TINYGL_H
 
+#include "common/array.h"
+#include "common/list.h"
+#include "common/rect.h"
+
 #include "engines/grim/gfx_base.h"
 
 #include "graphics/tinygl/zgl.h"
@@ -66,7 +70,7 @@ public:
 	void translateViewpointFinish();
 
 	void drawHierachyNode(const Model::HierNode *node);
-	void drawModelFace(const Model::Face *face, float *vertices, float *vertNormals, float *textureVerts);
+	void drawModelFaces(const Model::Mesh *mesh, const Model::FaceRun *run);
 
 	void disableLights();
 	void setupLight(Scene::Light *light, int lightId);
@@ -105,12 +109,40 @@ public:
 protected:
 
 private:
+	// a background layer bitmap, as drawn on the last frame
+	struct BackgroundDraw {
+		const Bitmap *bitmap;
+		int image;
+		int x, y;
+	};
+
+	void flushBackground();
+	void addDirtyRect(int x, int y, int width, int height);
+	void collectRasterized();
+	void markUntracked();
+
 	TinyGL::ZBuffer *_zb;
 	byte *_screen;
 	byte *_smushBitmap;
 	int _smushWidth;
 	int _smushHeight;
 	byte *_storedDisplay;
+	bool _tiledRaster;
+
+	// Damage tracking: the background layers are only redrawn when they
+	// change, otherwise the regions touched by the last frame are restored
+	// from a copy of them and only the changed regions are presented.
+	bool _dirtyRects;
+	bool _inBackground;
+	bool _backgroundValid;
+	bool _fullRedraw;
+	bool _untracked;
+	byte *_backgroundColor;
+	byte *_backgroundZ;
+	Common::Array<BackgroundDraw> _backgroundDraws;
+	Common::Array<BackgroundDraw> _lastBackgroundDraws;
+	Common::List<Common::Rect> _drawnRects;   // drawn over the background
+	Common::List<Common::Rect> _changedRects; // changed since the last flip
 };
 
 } // end of namespace Grim
@@ -270,6 +270,8 @@ GrimEngine::GrimEngine(OSystem *syst, int gameFlags, GrimGameType gameType) :
 	_mixer->setVolumeForSoundType(Audio::Mixer::kSpeechSoundType, ConfMan.getInt("speech_volume"));
 	_mixer->setVolumeForSoundType(Audio::Mixer::kMusicSoundType, ConfMan.getInt("music_volume"));
 
+	lua_settaskbudget(ConfMan.getInt("lua_task_budget"));
+
 	_currScene = NULL;
 	_selectedActor = NULL;
 	_controlsEnabled = new bool[KEYCODE_EXTRA_LAST];
@@ -334,6 +336,7 @@ GrimEngine::GrimEngine(OSystem *syst, int gameFlags, GrimGameType gameType) :
 }
 
 GrimEngine::~GrimEngine() {
+	SaveGame::finishWrites();
 	ObjectMan.clearTypes();
 
 	delete[] _controlsEnabled;
@@ -718,11 +721,14 @@ void GrimEngine::luaUpdate() {
 	_frameTime = newStart - _frameStart;
 	_frameStart = newStart;
 
+	// Collect a slice of the garbage every frame, starting a new cycle
+	// every ten seconds
 	_frameTimeCollection += _frameTime;
 	if (_frameTimeCollection > 10000) {
 		_frameTimeCollection = 0;
-		lua_collectgarbage(0);
-	}
+		lua_stepgarbage(1);
+	} else
+		lua_stepgarbage(0);
 
 	lua_beginblock();
 	setFrameTime(_frameTime);
@@ -760,10 +766,8 @@ void GrimEngine::updateDisplayScene() {
 		if (g_smush->isPlaying()) {
 			//_mode = ENGINE_MODE_NORMAL; ???
 			_movieTime = g_smush->getMovieTime();
-			if (g_smush->isUpdateNeeded()) {
-				g_driver->prepareSmushFrame(g_smush->getWidth(), g_smush->getHeight(), g_smush->getDstPtr());
-				g_smush->clearUpdateNeeded();
-			}
+			if (g_smush->isUpdateNeeded())
+				g_driver->prepareSmushFrame(g_smush->getWidth(), g_smush->getHeight(), g_smush->takeFrame());
 			int frame = g_smush->getFrame();
 			if (frame > 0) {
 				if (frame != _prevSmushFrame) {
@@ -809,10 +813,8 @@ void GrimEngine::updateDisplayScene() {
 		// up when he's next to Glottis's service room
 		if (g_smush->isPlaying()) {
 			_movieTime = g_smush->getMovieTime();
-			if (g_smush->isUpdateNeeded()) {
-				g_driver->prepareSmushFrame(g_smush->getWidth(), g_smush->getHeight(), g_smush->getDstPtr());
-				g_smush->clearUpdateNeeded();
-			}
+			if (g_smush->isUpdateNeeded())
+				g_driver->prepareSmushFrame(g_smush->getWidth(), g_smush->getHeight(), g_smush->takeFrame());
 			if (g_smush->getFrame() > 0)
 				g_driver->drawSmushFrame(g_smush->getX(), g_smush->getY());
 			else
@@ -894,6 +896,8 @@ void GrimEngine::mainLoop() {
 
 		g_imuse->flushTracks();
 		g_imuse->refreshScripts();
+		g_resourceloader->collectPrefetched();
+		SaveGame::pollWrites();
 
 		if (_mode == ENGINE_MODE_IDLE) {
 			// don't kill CPU
@@ -1384,10 +1388,18 @@ void GrimEngine::setScene(const char *name) {
 		setScene(scene);
 		return;
 	}
-	Block *b = g_resourceloader->getFileBlock(name);
-	if (!b)
+	// PreloadScene may have fetched the file already
+	Block *b = g_resourceloader->getBlock(name);
+	if (!b) {
 		warning("Could not find scene file %s", name);
+		return;
+	}
+	// the colormaps the scene loads must not evict its file
+	Common::String fname = name;
+	fname.toLowercase();
+	g_resourceloader->pinBlock(fname);
 	_currScene = new Scene(name, b->data(), b->len());
+	g_resourceloader->unpinBlock(fname);
 	registerScene(_currScene);
 	_currScene->setSoundParameters(20, 127);
 	// should delete the old scene after creating the new one
@@ -1395,7 +1407,6 @@ void GrimEngine::setScene(const char *name) {
 		removeScene(lastScene);
 		delete lastScene;
 	}
-	delete b;
 }
 
 void GrimEngine::setScene(Scene *scene) {
@@ -23,6 +23,7 @@
  *
  */
 
+#include "common/config-manager.h"
 #include "common/timer.h"
 
 #include "engines/grim/grim.h"
@@ -30,6 +31,7 @@
 #include "engines/grim/colormap.h"
 
 #include "engines/grim/imuse/imuse.h"
+#include "engines/grim/imuse/imuse_mcmp_mgr.h"
 
 #include "audio/audiostream.h"
 #include "audio/mixer.h"
@@ -63,6 +65,7 @@ Imuse::Imuse(int fps) {
 		_track[l]->trackId = l;
 	}
 	vimaInit(imuseDestTable);
+	McmpMgr::initCache(ConfMan.getInt("imuse_cache_size"));
 	if (g_grim->getGameFlags() & GF_DEMO) {
 		_stateMusicTable = grimDemoStateMusicTable;
 		_seqMusicTable = grimDemoSeqMusicTable;
@@ -80,6 +83,8 @@ Imuse::~Imuse() {
 		delete _track[l];
 	}
 	delete _sound;
+	McmpMgr::deinitCache();
+	ImuseStream::freePool();
 }
 
 void Imuse::resetState() {
@@ -144,7 +149,7 @@ void Imuse::restoreState(SaveGame *savedState) {
 		if (channels == 2)
 			track->mixerFlags |= kFlagStereo | kFlagReverseStereo;
 
-		track->stream = Audio::makeQueuingAudioStream(freq, (track->mixerFlags & kFlagStereo) != 0);
+		track->stream = new ImuseStream(freq, (track->mixerFlags & kFlagStereo) != 0);
 		g_system->getMixer()->playStream(track->getType(), &track->handle, track->stream, -1, track->getVol(),
 											track->getPan(), DisposeAfterUse::YES, false,
 											(track->mixerFlags & kFlagReverseStereo) != 0);
@@ -193,19 +198,6 @@ void Imuse::saveState(SaveGame *savedState) {
 	printf("Imuse::saveState() finished.\n");
 }
 
-int32 Imuse::makeMixerFlags(int32 flags) {
-	int32 mixerFlags = 0;
-	if (flags & kFlagUnsigned)
-		mixerFlags |= Audio::FLAG_UNSIGNED;
-	if (flags & kFlag16Bits)
-		mixerFlags |= Audio::FLAG_16BITS;
-	if (flags & kFlagLittleEndian)
-		mixerFlags |= Audio::FLAG_LITTLE_ENDIAN;
-	if (flags & kFlagStereo)
-		mixerFlags |= Audio::FLAG_STEREO;
-	return mixerFlags;
-}
-
 void Imuse::callback() {
 	Common::StackLock lock(_mutex);
 
@@ -271,7 +263,6 @@ void Imuse::callback() {
 			}
 
 			assert(track->stream);
-			byte *data = NULL;
 			int32 result = 0;
 
 			if (track->curRegion == -1) {
@@ -296,7 +287,14 @@ void Imuse::callback() {
 				continue;
 
 			do {
-				result = _sound->getDataFromRegion(track->soundDesc, track->curRegion, &data, track->regionOffset, mixer_size);
+				// Decode straight into the stream's ring. If it is full the
+				// mixer is behind and the rest is fed on the next tick.
+				int32 size = mixer_size;
+				byte *data = track->stream->getWriteBuffer(size);
+				if (size == 0)
+					break;
+
+				result = _sound->getDataFromRegion(track->soundDesc, track->curRegion, data, track->regionOffset, size);
 				if (channels == 1) {
 					result &= ~1;
 				}
@@ -308,10 +306,9 @@ void Imuse::callback() {
 					result = mixer_size;
 
 				if (g_system->getMixer()->isReady()) {
-					track->stream->queueBuffer(data, result, DisposeAfterUse::YES, makeMixerFlags(track->mixerFlags));
+					track->stream->commit(result);
 					track->regionOffset += result;
-				} else
-					delete[] data;
+				}
 
 				if (_sound->isEndOfRegion(track->soundDesc, track->curRegion)) {
 					switchToNextRegion(track);
@@ -321,6 +318,8 @@ void Imuse::callback() {
 				mixer_size -= result;
 				assert(mixer_size >= 0);
 			} while (mixer_size);
+			if (track->stream)
+				_sound->prefetchRegion(track->soundDesc, track->curRegion, track->regionOffset, track->curHookId);
 			if (g_system->getMixer()->isReady()) {
 				g_system->getMixer()->setChannelVolume(track->handle, track->getVol());
 				g_system->getMixer()->setChannelBalance(track->handle, track->getPan());
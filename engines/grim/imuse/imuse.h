@@ -55,7 +55,6 @@ private:
 	const ImuseTable *_stateMusicTable;
 	const ImuseTable *_seqMusicTable;
 
-	int32 makeMixerFlags(int32 flags);
 	static void timerHandler(void *refConf);
 	void callback();
 	void switchToNextRegion(Track *track);
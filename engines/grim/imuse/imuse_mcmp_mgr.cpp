@@ -24,6 +24,7 @@
  */
 
 #include "common/file.h"
+#include "common/timer.h"
 
 #include "engines/grim/grim.h"
 #include "engines/grim/colormap.h"
@@ -34,76 +35,220 @@ namespace Grim {
 
 uint16 imuseDestTable[5786];
 
+Common::Mutex McmpMgr::s_cacheMutex;
+Common::Array<McmpMgr::SharedSound *> McmpMgr::s_sounds;
+McmpMgr::CachedBlock *McmpMgr::s_lruHead = NULL;
+McmpMgr::CachedBlock *McmpMgr::s_lruTail = NULL;
+int McmpMgr::s_numBlocks = 0;
+int McmpMgr::s_maxBlocks = 0;
+McmpMgr::PendingBlock McmpMgr::s_pending[MAX_PENDING_BLOCKS];
+int McmpMgr::s_numPending = 0;
+
 McmpMgr::McmpMgr() {
-	_compTable = NULL;
-	_numCompItems = 0;
-	_curSample = -1;
-	_compInput = NULL;
-	_outputSize = 0;
-	_file = NULL;
-	_numCompItems = 0;
-	_lastBlock = -1;
+	_sound = NULL;
 }
 
 McmpMgr::~McmpMgr() {
-	delete _file;
-	delete[] _compTable;
-	delete[] _compInput;
+	if (_sound) {
+		Common::StackLock lock(s_cacheMutex);
+		releaseShared(_sound);
+	}
+}
+
+void McmpMgr::initCache(int32 size) {
+	// a few blocks are needed anyway for the tracks playing at once
+	s_maxBlocks = size / 0x2000;
+	if (s_maxBlocks < 16)
+		s_maxBlocks = 16;
+	g_system->getTimerManager()->installTimerProc(decoderHandler, 10000, NULL);
+}
+
+void McmpMgr::deinitCache() {
+	g_system->getTimerManager()->removeTimerProc(decoderHandler);
+	Common::StackLock lock(s_cacheMutex);
+	s_numPending = 0;
 }
 
 bool McmpMgr::openSound(const char *filename, byte **resPtr, int &offsetData) {
-	_file = g_resourceloader->openNewStreamFile(filename);
+	Common::StackLock lock(s_cacheMutex);
 
-	if (!_file || !_file->isOpen()) {
-		warning("McmpMgr::openSound() Can't open sound MCMP file: %s", filename);
+	_sound = openShared(filename);
+	if (!_sound)
 		return false;
+
+	*resPtr = _sound->header;
+	offsetData = _sound->headerSize;
+	return true;
+}
+
+McmpMgr::SharedSound *McmpMgr::openShared(const char *filename) {
+	for (uint l = 0; l < s_sounds.size(); l++) {
+		if (s_sounds[l]->name == filename) {
+			s_sounds[l]->refCount++;
+			return s_sounds[l];
+		}
+	}
+
+	Common::SeekableReadStream *file = g_resourceloader->openNewStreamFile(filename);
+
+	if (!file) {
+		warning("McmpMgr::openSound() Can't open sound MCMP file: %s", filename);
+		return NULL;
 	}
 
-	uint32 tag = _file->readUint32BE();
+	uint32 tag = file->readUint32BE();
 	if (tag != 'MCMP') {
 		error("McmpMgr::openSound() Expected MCMP tag");
-		return false;
+		delete file;
+		return NULL;
 	}
 
-	_numCompItems = _file->readSint16BE();
-	assert(_numCompItems > 0);
+	SharedSound *sound = new SharedSound;
+	sound->name = filename;
+	sound->refCount = 1;
+	sound->file = file;
 
-	int32 offset = _file->pos() + (_numCompItems * 9) + 2;
-	_numCompItems--;
-	_compTable = new CompTable[_numCompItems];
-	_file->seek(5, SEEK_CUR);
-	int32 headerSize = _compTable[0].decompSize = _file->readSint32BE();
+	int16 numCompItems = file->readSint16BE();
+	assert(numCompItems > 0);
+
+	int32 offset = file->pos() + (numCompItems * 9) + 2;
+	numCompItems--;
+	CompTable *compTable = new CompTable[numCompItems];
+	file->seek(5, SEEK_CUR);
+	int32 headerSize = file->readSint32BE();
 	int32 maxSize = headerSize;
 	offset += headerSize;
 
 	int i;
-	for (i = 0; i < _numCompItems; i++) {
-		_compTable[i].codec = _file->readByte();
-		_compTable[i].decompSize = _file->readSint32BE();
-		_compTable[i].compSize = _file->readSint32BE();
-		_compTable[i].offset = offset;
-		offset += _compTable[i].compSize;
-		if (_compTable[i].compSize > maxSize)
-			maxSize = _compTable[i].compSize;
+	for (i = 0; i < numCompItems; i++) {
+		compTable[i].codec = file->readByte();
+		compTable[i].decompSize = file->readSint32BE();
+		compTable[i].compSize = file->readSint32BE();
+		compTable[i].offset = offset;
+		offset += compTable[i].compSize;
+		if (compTable[i].compSize > maxSize)
+			maxSize = compTable[i].compSize;
 	}
-	int16 sizeCodecs = _file->readSint16BE();
-	for (i = 0; i < _numCompItems; i++) {
-		_compTable[i].offset += sizeCodecs;
+	int16 sizeCodecs = file->readSint16BE();
+	for (i = 0; i < numCompItems; i++) {
+		compTable[i].offset += sizeCodecs;
 	}
-	_file->seek(sizeCodecs, SEEK_CUR);
+	file->seek(sizeCodecs, SEEK_CUR);
+	sound->header = new byte[headerSize];
+	sound->headerSize = headerSize;
+	file->read(sound->header, headerSize);
+
+	sound->compTable = compTable;
+	sound->numCompItems = numCompItems;
 	// hack: two more bytes at the end of input buffer
-	_compInput = new byte[maxSize + 2];
-	_file->read(_compInput, headerSize);
-	*resPtr = _compInput;
-	offsetData = headerSize;
-	return true;
+	sound->compInput = new byte[maxSize + 2];
+	sound->blocks = new CachedBlock *[numCompItems];
+	memset(sound->blocks, 0, numCompItems * sizeof(CachedBlock *));
+
+	s_sounds.push_back(sound);
+	return sound;
+}
+
+void McmpMgr::releaseShared(SharedSound *sound) {
+	if (--sound->refCount > 0)
+		return;
+
+	for (int i = 0; i < sound->numCompItems; i++) {
+		if (sound->blocks[i]) {
+			unlinkBlock(sound->blocks[i]);
+			delete sound->blocks[i];
+			s_numBlocks--;
+		}
+	}
+
+	int n = 0;
+	for (int i = 0; i < s_numPending; i++) {
+		if (s_pending[i].sound != sound)
+			s_pending[n++] = s_pending[i];
+	}
+	s_numPending = n;
+
+	for (uint l = 0; l < s_sounds.size(); l++) {
+		if (s_sounds[l] == sound) {
+			s_sounds.remove_at(l);
+			break;
+		}
+	}
+
+	delete sound->file;
+	delete[] sound->compTable;
+	delete[] sound->compInput;
+	delete[] sound->header;
+	delete[] sound->blocks;
+	delete sound;
+}
+
+void McmpMgr::unlinkBlock(CachedBlock *cached) {
+	if (cached->prev)
+		cached->prev->next = cached->next;
+	else
+		s_lruHead = cached->next;
+	if (cached->next)
+		cached->next->prev = cached->prev;
+	else
+		s_lruTail = cached->prev;
+}
+
+McmpMgr::CachedBlock *McmpMgr::getBlock(SharedSound *sound, int block) {
+	CachedBlock *cached = sound->blocks[block];
+
+	if (cached) {
+		if (cached != s_lruHead) {
+			unlinkBlock(cached);
+			cached->prev = NULL;
+			cached->next = s_lruHead;
+			s_lruHead->prev = cached;
+			s_lruHead = cached;
+		}
+		return cached;
+	}
+
+	if (s_numBlocks < s_maxBlocks || !s_lruTail) {
+		cached = new CachedBlock;
+		s_numBlocks++;
+	} else {
+		// reuse the least recently used block
+		cached = s_lruTail;
+		unlinkBlock(cached);
+		cached->sound->blocks[cached->block] = NULL;
+	}
+
+	CompTable &comp = sound->compTable[block];
+	// hack: two more zero bytes at the end of input buffer
+	sound->compInput[comp.compSize] = 0;
+	sound->compInput[comp.compSize + 1] = 0;
+	sound->file->seek(comp.offset, SEEK_SET);
+	sound->file->read(sound->compInput, comp.compSize);
+	decompressVima(sound->compInput, (int16 *)cached->data, comp.decompSize, imuseDestTable);
+	if (comp.decompSize > 0x2000) {
+		error("McmpMgr::decompressSample() _outputSize: %d", comp.decompSize);
+	}
+
+	cached->sound = sound;
+	cached->block = block;
+	cached->size = comp.decompSize;
+	cached->prev = NULL;
+	cached->next = s_lruHead;
+	if (s_lruHead)
+		s_lruHead->prev = cached;
+	else
+		s_lruTail = cached;
+	s_lruHead = cached;
+	sound->blocks[block] = cached;
+
+	return cached;
 }
 
-int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
+int32 McmpMgr::decompressSample(int32 offset, int32 size, byte *comp_final) {
 	int32 i, final_size, output_size;
 	int skip, first_block, last_block;
 
-	if (!_file || !_file->isOpen()) {
+	if (!_sound) {
 		error("McmpMgr::decompressSampleByName() File is not open!");
 		return 0;
 	}
@@ -113,29 +258,16 @@ int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
 	skip = offset % 0x2000;
 
 	// Clip last_block by the total number of blocks (= "comp items")
-	if ((last_block >= _numCompItems) && (_numCompItems > 0))
-		last_block = _numCompItems - 1;
+	if ((last_block >= _sound->numCompItems) && (_sound->numCompItems > 0))
+		last_block = _sound->numCompItems - 1;
 
-	int32 blocks_final_size = 0x2000 * (1 + last_block - first_block);
-	*comp_final = (byte *)malloc(blocks_final_size * sizeof(byte));
 	final_size = 0;
 
+	Common::StackLock lock(s_cacheMutex);
 	for (i = first_block; i <= last_block; i++) {
-		if (_lastBlock != i) {
-			// hack: two more zero bytes at the end of input buffer
-			_compInput[_compTable[i].compSize] = 0;
-			_compInput[_compTable[i].compSize + 1] = 0;
-			_file->seek(_compTable[i].offset, SEEK_SET);
-			_file->read(_compInput, _compTable[i].compSize);
-			decompressVima(_compInput, (int16 *)_compOutput, _compTable[i].decompSize, imuseDestTable);
-			_outputSize = _compTable[i].decompSize;
-			if (_outputSize > 0x2000) {
-				error("McmpMgr::decompressSample() _outputSize: %d", _outputSize);
-			}
-			_lastBlock = i;
-		}
+		CachedBlock *cached = getBlock(_sound, i);
 
-		output_size = _outputSize - skip;
+		output_size = cached->size - skip;
 
 		if ((output_size + skip) > 0x2000) // workaround
 			output_size -= (output_size + skip) - 0x2000;
@@ -143,9 +275,7 @@ int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
 		if (output_size > size)
 			output_size = size;
 
-		assert(final_size + output_size <= blocks_final_size);
-
-		memcpy(*comp_final + final_size, _compOutput + skip, output_size);
+		memcpy(comp_final + final_size, cached->data + skip, output_size);
 		final_size += output_size;
 
 		size -= output_size;
@@ -159,4 +289,44 @@ int32 McmpMgr::decompressSample(int32 offset, int32 size, byte **comp_final) {
 	return final_size;
 }
 
+void McmpMgr::prefetch(int32 offset, int32 size) {
+	if (!_sound || size <= 0)
+		return;
+
+	int first_block = offset / 0x2000;
+	int last_block = (offset + size - 1) / 0x2000;
+	if (last_block >= _sound->numCompItems)
+		last_block = _sound->numCompItems - 1;
+
+	Common::StackLock lock(s_cacheMutex);
+	for (int i = first_block; i <= last_block; i++) {
+		if (_sound->blocks[i])
+			continue;
+		if (s_numPending == MAX_PENDING_BLOCKS)
+			return;
+		bool queued = false;
+		for (int l = 0; l < s_numPending; l++) {
+			if (s_pending[l].sound == _sound && s_pending[l].block == i) {
+				queued = true;
+				break;
+			}
+		}
+		if (!queued) {
+			s_pending[s_numPending].sound = _sound;
+			s_pending[s_numPending].block = i;
+			s_numPending++;
+		}
+	}
+}
+
+void McmpMgr::decoderHandler(void *) {
+	Common::StackLock lock(s_cacheMutex);
+
+	int count = s_numPending < BLOCKS_PER_TICK ? s_numPending : BLOCKS_PER_TICK;
+	for (int l = 0; l < count; l++)
+		getBlock(s_pending[l].sound, s_pending[l].block);
+	s_numPending -= count;
+	memmove(s_pending, s_pending + count, s_numPending * sizeof(PendingBlock));
+}
+
 } // end of namespace Grim
@@ -26,8 +26,17 @@
 #ifndef GRIM_MCMP_MGR_H
 #define GRIM_MCMP_MGR_H
 
+#include "common/array.h"
+#include "common/mutex.h"
+#include "common/str.h"
+
 namespace Grim {
 
+// Decoded VIMA blocks are kept in a cache shared by every McmpMgr opened
+// on the same file, so track clones, crossfades and region jumps don't
+// decode the same block again. The cache is bounded and evicts the least
+// recently used block. Blocks asked for with prefetch() are decoded from
+// a timer proc, ahead of the iMUSE callback needing them.
 class McmpMgr {
 private:
 
@@ -38,14 +47,55 @@ private:
 		int32 offset;
 	};
 
-	CompTable *_compTable;
-	int16 _numCompItems;
-	int _curSample;
-	Common::File *_file;
-	byte _compOutput[0x2000];
-	byte *_compInput;
-	int _outputSize;
-	int _lastBlock;
+	struct SharedSound;
+
+	struct CachedBlock {
+		SharedSound *sound;
+		int block;
+		int32 size;
+		CachedBlock *prev;
+		CachedBlock *next;
+		byte data[0x2000];
+	};
+
+	struct SharedSound {
+		Common::String name;
+		int refCount;
+		Common::SeekableReadStream *file;
+		CompTable *compTable;
+		int16 numCompItems;
+		byte *compInput;
+		byte *header;
+		int32 headerSize;
+		CachedBlock **blocks;
+	};
+
+	struct PendingBlock {
+		SharedSound *sound;
+		int block;
+	};
+
+	enum {
+		MAX_PENDING_BLOCKS = 64,
+		BLOCKS_PER_TICK = 4
+	};
+
+	SharedSound *_sound;
+
+	static Common::Mutex s_cacheMutex;
+	static Common::Array<SharedSound *> s_sounds;
+	static CachedBlock *s_lruHead;
+	static CachedBlock *s_lruTail;
+	static int s_numBlocks;
+	static int s_maxBlocks;
+	static PendingBlock s_pending[MAX_PENDING_BLOCKS];
+	static int s_numPending;
+
+	static SharedSound *openShared(const char *filename);
+	static void releaseShared(SharedSound *sound);
+	static CachedBlock *getBlock(SharedSound *sound, int block);
+	static void unlinkBlock(CachedBlock *cached);
+	static void decoderHandler(void *refCon);
 
 public:
 
@@ -53,7 +103,12 @@ public:
 	~McmpMgr();
 
 	bool openSound(const char *filename, byte **resPtr, int &offsetData);
-	int32 decompressSample(int32 offset, int32 size, byte **comp_final);
+	int32 decompressSample(int32 offset, int32 size, byte *comp_final);
+	// Queues the blocks covering offset..offset + size for the decoder.
+	void prefetch(int32 offset, int32 size);
+
+	static void initCache(int32 size);
+	static void deinitCache();
 };
 
 } // end of namespace Grim
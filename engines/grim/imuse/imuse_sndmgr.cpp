@@ -322,7 +322,7 @@ int ImuseSndMgr::getJumpFade(SoundDesc *sound, int number) {
 	return sound->jump[number].fadeDelay;
 }
 
-int32 ImuseSndMgr::getDataFromRegion(SoundDesc *sound, int region, byte **buf, int32 offset, int32 size) {
+int32 ImuseSndMgr::getDataFromRegion(SoundDesc *sound, int region, byte *buf, int32 offset, int32 size) {
 	assert(checkForProperHandle(sound));
 	assert(buf && offset >= 0 && size >= 0);
 	assert(region >= 0 && region < sound->numRegions);
@@ -340,11 +340,39 @@ int32 ImuseSndMgr::getDataFromRegion(SoundDesc *sound, int region, byte **buf, i
 	if (sound->mcmpData) {
 		size = sound->mcmpMgr->decompressSample(region_offset + offset, size, buf);
 	} else {
-		*buf = (byte *)malloc(sizeof(byte) * size);
-		memcpy(*buf, sound->resPtr + region_offset + offset, size);
+		memcpy(buf, sound->resPtr + region_offset + offset, size);
 	}
 
 	return size;
 }
 
+void ImuseSndMgr::prefetchRegion(SoundDesc *sound, int region, int32 offset, int hookId) {
+	assert(checkForProperHandle(sound));
+	assert(region >= 0 && region < sound->numRegions);
+
+	if (!sound->mcmpData)
+		return;
+
+	int32 size = sound->region[region].length - offset;
+	if (size > IMUSE_PREFETCH_SIZE)
+		size = IMUSE_PREFETCH_SIZE;
+	if (size > 0)
+		sound->mcmpMgr->prefetch(sound->region[region].offset + offset, size);
+	else
+		size = 0;
+
+	// Close to the end of the region, also decode the start of the region
+	// played next, following the jump Imuse::switchToNextRegion() will take.
+	if (size < IMUSE_PREFETCH_SIZE && region + 1 < sound->numRegions) {
+		int next = region + 1;
+		int jumpId = getJumpIdByRegionAndHookId(sound, next, hookId);
+		if (jumpId == -1)
+			jumpId = getJumpIdByRegionAndHookId(sound, next, 0);
+		if (jumpId != -1)
+			next = getRegionIdByJumpId(sound, jumpId);
+		if (next != -1)
+			sound->mcmpMgr->prefetch(sound->region[next].offset, IMUSE_PREFETCH_SIZE - size);
+	}
+}
+
 } // end of namespace Grim
@@ -49,6 +49,9 @@ public:
 #define IMUSE_VOLGRP_MUSIC  3
 #define IMUSE_VOLGRP_VOICE  4
 
+// How far ahead of the played position compressed sounds are decoded
+#define IMUSE_PREFETCH_SIZE 0x4000
+
 private:
 	struct Region {
 		int32 offset;		// offset of region
@@ -113,7 +116,8 @@ public:
 	int getJumpHookId(SoundDesc *sound, int number);
 	int getJumpFade(SoundDesc *sound, int number);
 
-	int32 getDataFromRegion(SoundDesc *sound, int region, byte **buf, int32 offset, int32 size);
+	int32 getDataFromRegion(SoundDesc *sound, int region, byte *buf, int32 offset, int32 size);
+	void prefetchRegion(SoundDesc *sound, int region, int32 offset, int hookId);
 };
 
 } // end of namespace Grim
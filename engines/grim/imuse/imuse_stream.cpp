@@ -0,0 +1,122 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#include "common/endian.h"
+
+#include "engines/grim/imuse/imuse_stream.h"
+
+namespace Grim {
+
+Common::Array<byte *> ImuseStream::s_pool;
+Common::Mutex ImuseStream::s_poolMutex;
+
+ImuseStream::ImuseStream(int rate, bool stereo) {
+	_readPos = 0;
+	_writePos = 0;
+	_finished = false;
+	_rate = rate;
+	_stereo = stereo;
+
+	Common::StackLock lock(s_poolMutex);
+	if (s_pool.empty()) {
+		_ring = new byte[RING_SIZE];
+	} else {
+		_ring = s_pool.back();
+		s_pool.pop_back();
+	}
+}
+
+ImuseStream::~ImuseStream() {
+	Common::StackLock lock(s_poolMutex);
+	s_pool.push_back(_ring);
+}
+
+void ImuseStream::freePool() {
+	Common::StackLock lock(s_poolMutex);
+	for (uint i = 0; i < s_pool.size(); i++)
+		delete[] s_pool[i];
+	s_pool.clear();
+}
+
+byte *ImuseStream::getWriteBuffer(int32 &size) {
+	uint32 pos, space;
+	{
+		Common::StackLock lock(_mutex);
+		pos = _writePos;
+		space = RING_SIZE - (pos - _readPos);
+	}
+	uint32 offset = pos & (RING_SIZE - 1);
+
+	if (space > RING_SIZE - offset)
+		space = RING_SIZE - offset;
+	if ((uint32)size > space)
+		size = space;
+	return _ring + offset;
+}
+
+void ImuseStream::commit(int32 size) {
+	Common::StackLock lock(_mutex);
+	assert(size >= 0 && (uint32)size <= RING_SIZE - (_writePos - _readPos));
+	_writePos += size;
+}
+
+void ImuseStream::finish() {
+	Common::StackLock lock(_mutex);
+	_finished = true;
+}
+
+bool ImuseStream::endOfData() const {
+	Common::StackLock lock(_mutex);
+	return _readPos == _writePos;
+}
+
+bool ImuseStream::endOfStream() const {
+	Common::StackLock lock(_mutex);
+	return _finished && _readPos == _writePos;
+}
+
+int ImuseStream::readBuffer(int16 *buffer, const int numSamples) {
+	uint32 pos;
+	int samples;
+	{
+		Common::StackLock lock(_mutex);
+		pos = _readPos;
+		samples = (_writePos - pos) / 2;
+	}
+
+	if (samples > numSamples)
+		samples = numSamples;
+	for (int i = 0; i < samples; i++) {
+		buffer[i] = (int16)READ_BE_UINT16(_ring + (pos & (RING_SIZE - 1)));
+		pos += 2;
+	}
+
+	Common::StackLock lock(_mutex);
+	_readPos = pos;
+
+	return samples;
+}
+
+} // end of namespace Grim
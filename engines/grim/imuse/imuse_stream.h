@@ -0,0 +1,87 @@
+/* Residual - A 3D game interpreter
+ *
+ * Residual is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA
+ *
+ * $URL$
+ * $Id$
+ *
+ */
+
+#ifndef GRIM_IMUSE_STREAM_H
+#define GRIM_IMUSE_STREAM_H
+
+#include "common/array.h"
+#include "common/mutex.h"
+
+#include "audio/audiostream.h"
+
+namespace Grim {
+
+// Single producer, single consumer ring of big endian 16 bit samples.
+// The iMUSE callback decodes straight into the free part of the ring and
+// the mixer reads from the filled part, so streaming a track doesn't
+// allocate anything once it has started.
+//
+// Each position is only written by one side, the producer advances
+// _writePos and the mixer advances _readPos. The positions are read and
+// updated under _mutex, which also orders them against the samples in the
+// ring on weakly ordered CPUs; the samples are copied without holding it.
+// The ring buffers themselves come from a pool and are recycled when the
+// mixer deletes a finished stream.
+class ImuseStream : public Audio::AudioStream {
+public:
+	enum {
+		RING_SIZE = 0x10000
+	};
+
+	ImuseStream(int rate, bool stereo);
+	~ImuseStream();
+
+	// Returns where the next size bytes can be written. size is clipped to
+	// the contiguous free space, which is 0 when the ring is full.
+	byte *getWriteBuffer(int32 &size);
+	// Makes size bytes written at getWriteBuffer() available to the mixer.
+	void commit(int32 size);
+	// No data will be written anymore, the stream ends once it is drained.
+	void finish();
+
+	int readBuffer(int16 *buffer, const int numSamples);
+	bool isStereo() const { return _stereo; }
+	int getRate() const { return _rate; }
+	bool endOfData() const;
+	bool endOfStream() const;
+
+	static void freePool();
+
+private:
+	byte *_ring;
+	uint32 _readPos;
+	uint32 _writePos;
+	bool _finished;
+	mutable Common::Mutex _mutex;
+	int _rate;
+	bool _stereo;
+
+	static Common::Array<byte *> s_pool;
+	static Common::Mutex s_poolMutex;
+};
+
+} // end of namespace Grim
+
+#endif
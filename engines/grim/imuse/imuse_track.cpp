@@ -139,7 +139,7 @@ bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int vo
 		track->regionOffset = otherTrack->regionOffset;
 	}
 
-	track->stream = Audio::makeQueuingAudioStream(freq, track->mixerFlags & kFlagStereo);
+	track->stream = new ImuseStream(freq, (track->mixerFlags & kFlagStereo) != 0);
 	g_system->getMixer()->playStream(track->getType(), &track->handle, track->stream, -1,
 											track->getVol(), track->getPan(), DisposeAfterUse::YES,
 											false, (track->mixerFlags & kFlagReverseStereo) != 0);
@@ -378,7 +378,7 @@ Track *Imuse::cloneToFadeOutTrack(Track *track, int fadeDelay) {
 	fadeTrack->volFadeUsed = true;
 
 	// Create an appendable output buffer
-	fadeTrack->stream = Audio::makeQueuingAudioStream(_sound->getFreq(fadeTrack->soundDesc), track->mixerFlags & kFlagStereo);
+	fadeTrack->stream = new ImuseStream(_sound->getFreq(fadeTrack->soundDesc), (track->mixerFlags & kFlagStereo) != 0);
 	g_system->getMixer()->playStream(track->getType(), &fadeTrack->handle, fadeTrack->stream, -1, fadeTrack->getVol(),
 											fadeTrack->getPan(), DisposeAfterUse::YES, false,
 											(track->mixerFlags & kFlagReverseStereo) != 0);
@@ -27,6 +27,7 @@
 #define GRIM_IMUSE_TRACK_H
 
 #include "engines/grim/imuse/imuse_sndmgr.h"
+#include "engines/grim/imuse/imuse_stream.h"
 
 namespace Grim {
 
@@ -66,7 +67,7 @@ struct Track {
 
 	ImuseSndMgr::SoundDesc *soundDesc;
 	Audio::SoundHandle handle;
-	Audio::QueuingAudioStream *stream;
+	ImuseStream *stream;
 
 	Track() : used(false), stream(NULL) {
 		soundName[0] = 0;
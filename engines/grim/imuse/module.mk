@@ -6,6 +6,7 @@ MODULE_OBJS := \
 	imuse_music.o \
 	imuse_script.o \
 	imuse_sndmgr.o \
+	imuse_stream.o \
 	imuse_tables.o \
 	imuse_track.o
 
@@ -145,7 +145,7 @@ KeyframeAnim::~KeyframeAnim() {
 	g_resourceloader->uncacheKeyframe(this);
 }
 
-void KeyframeAnim::animate(Model::HierNode *nodes, float time, int priority1, int priority2) const {
+void KeyframeAnim::animate(Model::HierNode *nodes, float time, int priority1, int priority2, int *cursors) const {
 	float frame = time * _fps;
 
 	if (frame > _numFrames)
@@ -153,7 +153,18 @@ void KeyframeAnim::animate(Model::HierNode *nodes, float time, int priority1, in
 
 	for (int i = 0; i < _numJoints; i++) {
 		if (_nodes[i])
-			_nodes[i]->animate(nodes[i], frame, ((_type & nodes[i]._type) != 0 ? priority2 : priority1));
+			_nodes[i]->animate(nodes[i], frame, ((_type & nodes[i]._type) != 0 ? priority2 : priority1),
+							   cursors ? &cursors[i] : NULL);
+	}
+}
+
+// Samples the nodes once per frame, so that playing them back needs
+// no lookup at all. Meant for the animations that play all the time,
+// like walk and rest loops.
+void KeyframeAnim::bake() {
+	for (int i = 0; i < _numJoints; i++) {
+		if (_nodes[i])
+			_nodes[i]->bake(_numFrames);
 	}
 }
 
@@ -210,17 +221,26 @@ void KeyframeAnim::KeyframeNode::loadText(TextSplitter &ts) {
 
 KeyframeAnim::KeyframeNode::~KeyframeNode() {
 	delete[] _entries;
+	delete[] _samples;
 }
 
-void KeyframeAnim::KeyframeNode::animate(Model::HierNode &node, float frame, int priority) const {
-	if (_numEntries == 0)
-		return;
-	if (priority < node._priority)
-		return;
-
+int KeyframeAnim::KeyframeNode::findEntry(float frame, int *cursor) const {
 	// Do a binary search for the nearest previous frame
 	// Loop invariant: entries_[low].frame_ <= frame < entries_[high].frame_
 	int low = 0, high = _numEntries;
+
+	// While playing forward the entry is almost always the one of the
+	// last call or the next one, so check those before searching
+	if (cursor && *cursor >= 0 && *cursor < _numEntries && _entries[*cursor]._frame <= frame) {
+		low = *cursor;
+		if (low + 1 < _numEntries && _entries[low + 1]._frame <= frame) {
+			low++;
+			if (low + 1 >= _numEntries || _entries[low + 1]._frame > frame)
+				high = low + 1;
+		} else
+			high = low + 1;
+	}
+
 	while (high > low + 1) {
 		int mid = (low + high) / 2;
 		if (_entries[mid]._frame <= frame)
@@ -229,11 +249,75 @@ void KeyframeAnim::KeyframeNode::animate(Model::HierNode &node, float frame, int
 			high = mid;
 	}
 
-	float dt = frame - _entries[low]._frame;
-	Graphics::Vector3d pos = _entries[low]._pos + dt * _entries[low]._dpos;
-	float pitch = _entries[low]._pitch + dt * _entries[low]._dpitch;
-	float yaw = _entries[low]._yaw + dt * _entries[low]._dyaw;
-	float roll = _entries[low]._roll + dt * _entries[low]._droll;
+	if (cursor)
+		*cursor = low;
+	return low;
+}
+
+void KeyframeAnim::KeyframeNode::bake(int numFrames) {
+	if (_samples || _numEntries == 0)
+		return;
+
+	// The samples only reproduce the entries when those start on whole
+	// frames, otherwise keep looking them up
+	for (int i = 0; i < _numEntries; i++) {
+		if ((float)(int)_entries[i]._frame != _entries[i]._frame)
+			return;
+	}
+
+	_numSamples = numFrames + 1;
+	_samples = new float[SAMPLE_CHANNELS * _numSamples];
+
+	int cursor = 0;
+	for (int f = 0; f < _numSamples; f++) {
+		const KeyframeEntry &entry = _entries[findEntry((float)f, &cursor)];
+		float dt = f - entry._frame;
+		Graphics::Vector3d pos = entry._pos + dt * entry._dpos;
+
+		_samples[SAMPLE_X * _numSamples + f] = pos.x();
+		_samples[SAMPLE_Y * _numSamples + f] = pos.y();
+		_samples[SAMPLE_Z * _numSamples + f] = pos.z();
+		_samples[SAMPLE_PITCH * _numSamples + f] = entry._pitch + dt * entry._dpitch;
+		_samples[SAMPLE_YAW * _numSamples + f] = entry._yaw + dt * entry._dyaw;
+		_samples[SAMPLE_ROLL * _numSamples + f] = entry._roll + dt * entry._droll;
+		_samples[SAMPLE_DX * _numSamples + f] = entry._dpos.x();
+		_samples[SAMPLE_DY * _numSamples + f] = entry._dpos.y();
+		_samples[SAMPLE_DZ * _numSamples + f] = entry._dpos.z();
+		_samples[SAMPLE_DPITCH * _numSamples + f] = entry._dpitch;
+		_samples[SAMPLE_DYAW * _numSamples + f] = entry._dyaw;
+		_samples[SAMPLE_DROLL * _numSamples + f] = entry._droll;
+	}
+}
+
+void KeyframeAnim::KeyframeNode::animate(Model::HierNode &node, float frame, int priority, int *cursor) const {
+	if (_numEntries == 0)
+		return;
+	if (priority < node._priority)
+		return;
+
+	Graphics::Vector3d pos;
+	float pitch, yaw, roll;
+	if (_samples && frame >= 0) {
+		int f = (int)frame;
+		if (f >= _numSamples)
+			f = _numSamples - 1;
+		float dt = frame - f;
+		const float *s = _samples + f;
+
+		pos = Graphics::Vector3d(s[SAMPLE_X * _numSamples] + dt * s[SAMPLE_DX * _numSamples],
+								 s[SAMPLE_Y * _numSamples] + dt * s[SAMPLE_DY * _numSamples],
+								 s[SAMPLE_Z * _numSamples] + dt * s[SAMPLE_DZ * _numSamples]);
+		pitch = s[SAMPLE_PITCH * _numSamples] + dt * s[SAMPLE_DPITCH * _numSamples];
+		yaw = s[SAMPLE_YAW * _numSamples] + dt * s[SAMPLE_DYAW * _numSamples];
+		roll = s[SAMPLE_ROLL * _numSamples] + dt * s[SAMPLE_DROLL * _numSamples];
+	} else {
+		const KeyframeEntry &entry = _entries[findEntry(frame, cursor)];
+		float dt = frame - entry._frame;
+		pos = entry._pos + dt * entry._dpos;
+		pitch = entry._pitch + dt * entry._dpitch;
+		yaw = entry._yaw + dt * entry._dyaw;
+		roll = entry._roll + dt * entry._droll;
+	}
 	if (pitch > 180)
 		pitch -= 360;
 	if (yaw > 180)
@@ -39,8 +39,12 @@ public:
 
 	void loadBinary(const char *data, int len);
 	void loadText(TextSplitter &ts);
-	void animate(Model::HierNode *nodes, float time, int priority1 = 1, int priority2 = 5) const;
+	// cursors, when given, holds one entry index per joint which is kept
+	// between calls to speed up the lookup while playing forward
+	void animate(Model::HierNode *nodes, float time, int priority1 = 1, int priority2 = 5, int *cursors = NULL) const;
+	void bake();
 
+	int numJoints() const { return _numJoints; }
 	float length() const { return _numFrames / _fps; }
 	const char *filename() const { return _fname.c_str(); }
 
@@ -66,16 +70,31 @@ private:
 		float _pitch, _yaw, _roll, _dpitch, _dyaw, _droll;
 	};
 
+	// Channels of the baked samples
+	enum {
+		SAMPLE_X, SAMPLE_Y, SAMPLE_Z, SAMPLE_PITCH, SAMPLE_YAW, SAMPLE_ROLL,
+		SAMPLE_DX, SAMPLE_DY, SAMPLE_DZ, SAMPLE_DPITCH, SAMPLE_DYAW, SAMPLE_DROLL,
+		SAMPLE_CHANNELS
+	};
+
 	struct KeyframeNode {
+		KeyframeNode() : _samples(NULL), _numSamples(0) { }
 		void loadBinary(const char *&data);
 		void loadText(TextSplitter &ts);
 		~KeyframeNode();
 
-		void animate(Model::HierNode &node, float frame, int priority) const;
+		int findEntry(float frame, int *cursor) const;
+		void bake(int numFrames);
+		void animate(Model::HierNode &node, float frame, int priority, int *cursor) const;
 
 		char _meshName[32];
 		int _numEntries;
 		KeyframeEntry *_entries;
+
+		// Value and slope of every channel at each whole frame, stored
+		// channel by channel, or NULL when the node isn't baked
+		float *_samples;
+		int _numSamples;
 	};
 
 	KeyframeNode **_nodes;
@@ -25,6 +25,17 @@
 
 #include "common/endian.h"
 #include "common/file.h"
+#include "common/fs.h"
+#include "common/config-manager.h"
+#include "common/memstream.h"
+#include "common/substream.h"
+
+#if defined(UNIX)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "engines/grim/grim.h"
 #include "engines/grim/lab.h"
@@ -54,9 +65,64 @@ bool Lab::open(const Common::String &filename) {
 	else
 		parseMonkey4FileTable();
 
+	// Once the archive is mapped every resource is served from memory,
+	// so the file handle is no longer needed
+	if (ConfMan.getBool("lab_mmap") && mapArchive()) {
+		delete _f;
+		_f = NULL;
+	} else {
+		// The prefetcher reads from the timer thread, it can't share _f
+		// with the main thread
+		_prefetchFile = new Common::File();
+		if (!_prefetchFile->open(filename)) {
+			delete _prefetchFile;
+			_prefetchFile = NULL;
+		}
+	}
+
 	return true;
 }
 
+bool Lab::mapArchive() {
+#if defined(UNIX)
+	Common::FSNode node = Common::FSNode(ConfMan.get("path")).getChild(_labFileName);
+	if (!node.exists())
+		return false;
+
+	int fd = ::open(node.getPath().c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+
+	// Map privately and writable so a stray write into a resource only
+	// touches a copy-on-write page instead of faulting.
+	void *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	_mapData = (byte *)data;
+	_mapSize = st.st_size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Lab::unmapArchive() {
+#if defined(UNIX)
+	if (_mapData)
+		munmap(_mapData, _mapSize);
+#endif
+	_mapData = NULL;
+	_mapSize = 0;
+}
+
 void Lab::parseGrimFileTable() {
 	uint32 entryCount = _f->readUint32LE();
 	uint32 stringTableSize = _f->readUint32LE();
@@ -122,44 +188,82 @@ bool Lab::fileExists(const Common::String &filename) const {
 }
 
 bool Lab::isOpen() const {
-	return _f && _f->isOpen();
+	return _mapData || (_f && _f->isOpen());
 }
 
 Block *Lab::getFileBlock(const Common::String &filename) const {
 	if (!fileExists(filename))
 		return 0;
 
-	const LabEntry &i = _entries[filename];
+	return getFileBlock(_entries[filename]);
+}
+
+Block *Lab::getFileBlock(const LabEntry &entry) const {
+	if (_mapData)
+		return new Block((const char *)_mapData + entry.offset, entry.len, DisposeAfterUse::NO);
 
-	_f->seek(i.offset, SEEK_SET);
-	char *data = new char[i.len];
-	_f->read(data, i.len);
-	return new Block(data, i.len);
+	_f->seek(entry.offset, SEEK_SET);
+	char *data = new char[entry.len];
+	_f->read(data, entry.len);
+	return new Block(data, entry.len);
 }
 
 LuaFile *Lab::openNewStreamLua(const Common::String &filename) const {
 	if (!fileExists(filename))
 		return 0;
 
-	Common::File *file = new Common::File();
-	file->open(_labFileName);
-	file->seek(_entries[filename].offset, SEEK_SET);
+	return openNewStreamLua(_entries[filename]);
+}
+
+LuaFile *Lab::openNewStreamLua(const LabEntry &entry) const {
+	Common::SeekableReadStream *stream = openNewStreamFile(entry);
+	if (!stream)
+		return 0;
 
 	LuaFile *filehandle = new LuaFile();
-	filehandle->_in = file;
+	filehandle->_in = stream;
 
 	return filehandle;
 }
 
-Common::File *Lab::openNewStreamFile(const Common::String &filename) const {
+Common::SeekableReadStream *Lab::openNewStreamFile(const Common::String &filename) const {
 	if (!fileExists(filename))
 		return 0;
 
+	return openNewStreamFile(_entries[filename]);
+}
+
+Common::SeekableReadStream *Lab::openNewStreamFile(const LabEntry &entry) const {
+	if (_mapData)
+		return new Common::MemoryReadStream(_mapData + entry.offset, entry.len);
+
 	Common::File *file = new Common::File();
-	file->open(_labFileName);
-	file->seek(_entries[filename].offset, SEEK_SET);
+	if (!file->open(_labFileName)) {
+		delete file;
+		return 0;
+	}
+
+	return new Common::SeekableSubReadStream(file, entry.offset, entry.offset + entry.len, DisposeAfterUse::YES);
+}
+
+Block *Lab::prefetchFileBlock(const LabEntry &entry) const {
+	if (_mapData) {
+		// Touch every page of the entry so it is resident by the time
+		// the main thread parses it
+		const byte *data = _mapData + entry.offset;
+		volatile byte sum = 0;
+		for (int i = 0; i < entry.len; i += 4096)
+			sum += data[i];
+		return new Block((const char *)data, entry.len, DisposeAfterUse::NO);
+	}
+
+	if (!_prefetchFile)
+		return 0;
 
-	return file;
+	_prefetchFile->seek(entry.offset, SEEK_SET);
+	char *data = new char[entry.len];
+	_prefetchFile->read(data, entry.len);
+	return new Block(data, entry.len);
 }
 
 int Lab::fileLength(const Common::String &filename) const {
@@ -170,8 +274,12 @@ int Lab::fileLength(const Common::String &filename) const {
 }
 
 void Lab::close() {
+	unmapArchive();
+
 	delete _f;
 	_f = NULL;
+	delete _prefetchFile;
+	_prefetchFile = NULL;
 
 	_entries.clear();
 }
@@ -29,54 +29,78 @@
 #include "common/hashmap.h"
 #include "common/hash-str.h"
 #include "common/str.h"
+#include "common/types.h"
 
 namespace Common {
 	class File;
+	class SeekableReadStream;
 }
 
 namespace Grim {
 
 class LuaFile;
 
+/**
+ * A resource loaded from a LAB archive. When the archive is memory mapped
+ * the block is only a view into the mapping and does not own its data.
+ */
 class Block {
 public:
-	Block(const char *dataPtr, int length) : _data(dataPtr), _len(length) {}
+	Block(const char *dataPtr, int length, DisposeAfterUse::Flag disposeData = DisposeAfterUse::YES) :
+		_data(dataPtr), _len(length), _disposeData(disposeData) {}
 	const char *data() const { return _data; }
 	int len() const { return _len; }
+	bool ownsData() const { return _disposeData == DisposeAfterUse::YES; }
 
-	~Block() { delete[] _data; }
+	~Block() {
+		if (_disposeData == DisposeAfterUse::YES)
+			delete[] _data;
+	}
 
 private:
 	Block();
 	const char *_data;
 	int _len;
+	DisposeAfterUse::Flag _disposeData;
 };
 
 class Lab {
 public:
-	Lab() : _f(NULL) { }
+	Lab() : _f(NULL), _prefetchFile(NULL), _mapData(NULL), _mapSize(0) { }
 
 	bool open(const Common::String &filename);
 	bool isOpen() const;
 	void close();
 	bool fileExists(const Common::String &filename) const;
 	Block *getFileBlock(const Common::String &filename) const;
-	Common::File *openNewStreamFile(const Common::String &filename) const;
+	Common::SeekableReadStream *openNewStreamFile(const Common::String &filename) const;
 	LuaFile *openNewStreamLua(const Common::String &filename) const;
 	int fileLength(const Common::String &filename) const;
+	bool isMapped() const { return _mapData != NULL; }
 
 	~Lab() { close(); }
 
 	struct LabEntry {
 		int offset, len;
 	};
+	typedef Common::HashMap<Common::String, LabEntry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> LabMap;
+
+	const LabMap &getEntries() const { return _entries; }
+	Block *getFileBlock(const LabEntry &entry) const;
+	Common::SeekableReadStream *openNewStreamFile(const LabEntry &entry) const;
+	LuaFile *openNewStreamLua(const LabEntry &entry) const;
+	Block *prefetchFileBlock(const LabEntry &entry) const;
 
 private:
 	void parseGrimFileTable();
 	void parseMonkey4FileTable();
+	bool mapArchive();
+	void unmapArchive();
 
 	Common::File *_f;
-	typedef Common::HashMap<Common::String, LabEntry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> LabMap;
+	Common::File *_prefetchFile;
+	byte *_mapData;
+	uint32 _mapSize;
 	LabMap _entries;
 	Common::String _labFileName;
 };
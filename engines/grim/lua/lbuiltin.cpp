@@ -510,6 +510,8 @@ static struct luaL_reg int_funcs[] = {
 	{ "pause_scripts", pause_scripts },
 	{ "unpause_scripts", unpause_scripts },
 	{ "find_script", find_script },
+	{ "set_script_priority", set_script_priority },
+	{ "script_stats", script_stats },
 	{ "break_here", break_here }
 };
 
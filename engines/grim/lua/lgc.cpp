@@ -129,20 +129,53 @@ void luaC_strcallIM(TaggedString *l) {
 	}
 }
 
-static GCnode *listcollect(GCnode *l) {
-	GCnode *frees = NULL;
-	while (l) {
-		GCnode *next = l->next;
-		l->marked = 0;
-		while (next && !next->marked) {
-			l->next = next->next;
-			next->next = frees;
-			frees = next;
-			next = l->next;
-		}
-		l = next;
+/*
+** =======================================================
+** Incremental collector
+** =======================================================
+** A cycle marks the roots, then traverses the gray objects a few at a
+** time. Stores into tables already traversed put them back on the gray
+** list, and the roots are marked again before sweeping, so nothing
+** reachable is left white. The string tables and the object lists are
+** then swept a piece at a time as well.
+*/
+
+enum GCPhase {
+	GC_IDLE,
+	GC_MARK,
+	GC_SWEEP
+};
+
+struct SweepList {
+	GCnode *root;
+	GCnode *pending;  // objects not swept yet
+	GCnode *kept, *keptTail;  // swept objects which are still alive
+};
+
+#define NUM_SWEEPLISTS	3
+
+static GCPhase gcphase = GC_IDLE;
+static int32 gcbusy = 0;  // to avoid GC during GC
+static TObject *graylist = NULL;
+static int32 graysize = 0;
+static int32 graytop = 0;
+static int32 sweepstring;  // next string table to sweep
+static int32 sweeplist;  // next object list to sweep
+static SweepList sweeplists[NUM_SWEEPLISTS];
+
+static void pushgray(lua_Type type, Value value) {
+	if (graytop == graysize)
+		graysize = luaM_growvector(&graylist, graysize, TObject, "gray list overflow", MAX_INT);
+	ttype(&graylist[graytop]) = type;
+	graylist[graytop].value = value;
+	graytop++;
+}
+
+static void graymark(GCnode *head, lua_Type type, Value value) {
+	if (head->marked == GC_WHITE) {
+		head->marked = GC_GRAY;
+		pushgray(type, value);
 	}
-	return frees;
 }
 
 static void strmark(TaggedString *s) {
@@ -150,45 +183,42 @@ static void strmark(TaggedString *s) {
 		s->head.marked = 1;
 }
 
-static void protomark(TProtoFunc *f) {
-	if (!f->head.marked) {
-		LocVar *v = f->locvars;
-		int32 i;
-		f->head.marked = 1;
-		if (f->fileName)
-			strmark(f->fileName);
-		for (i = 0; i < f->nconsts; i++)
-			markobject(&f->consts[i]);
-		if (v) {
-			for (; v->line != -1; v++) {
-				if (v->varname)
-					strmark(v->varname);
-			}
+static int32 protomark(TProtoFunc *f) {
+	LocVar *v = f->locvars;
+	int32 i;
+	f->head.marked = GC_BLACK;
+	if (f->fileName)
+		strmark(f->fileName);
+	for (i = 0; i < f->nconsts; i++)
+		markobject(&f->consts[i]);
+	if (v) {
+		for (; v->line != -1; v++) {
+			if (v->varname)
+				strmark(v->varname);
 		}
 	}
+	return 1 + f->nconsts;
 }
 
-static void closuremark(Closure *f) {
-	if (!f->head.marked) {
-		int32 i;
-		f->head.marked = 1;
-		for (i = f->nelems; i >= 0; i--)
-			markobject(&f->consts[i]);
-	}
+static int32 closuremark(Closure *f) {
+	int32 i;
+	f->head.marked = GC_BLACK;
+	for (i = f->nelems; i >= 0; i--)
+		markobject(&f->consts[i]);
+	return 1 + f->nelems;
 }
 
-static void hashmark(Hash *h) {
-	if (!h->head.marked) {
-		int32 i;
-		h->head.marked = 1;
-		for (i = 0; i < nhash(h); i++) {
-			Node *n = node(h, i);
-			if (ttype(ref(n)) != LUA_T_NIL) {
-				markobject(&n->ref);
-				markobject(&n->val);
-			}
+static int32 hashmark(Hash *h) {
+	int32 i;
+	h->head.marked = GC_BLACK;
+	for (i = 0; i < nhash(h); i++) {
+		Node *n = node(h, i);
+		if (ttype(ref(n)) != LUA_T_NIL) {
+			markobject(&n->ref);
+			markobject(&n->val);
 		}
 	}
+	return 1 + nhash(h);
 }
 
 static void globalmark() {
@@ -208,15 +238,15 @@ static int32 markobject(TObject *o) {
 		strmark(tsvalue(o));
 		break;
 	case LUA_T_ARRAY:
-		hashmark(avalue(o));
+		graymark(&avalue(o)->head, LUA_T_ARRAY, o->value);
 		break;
 	case LUA_T_CLOSURE:
 	case LUA_T_CLMARK:
-		closuremark(o->value.cl);
+		graymark(&o->value.cl->head, LUA_T_CLOSURE, o->value);
 		break;
 	case LUA_T_PROTO:
 	case LUA_T_PMARK:
-		protomark(o->value.tf);
+		graymark(&o->value.tf->head, LUA_T_PROTO, o->value);
 		break;
 	default:
 		break;  // numbers, cprotos, etc
@@ -231,34 +261,192 @@ static void markall() {
 	luaT_travtagmethods(markobject);  // mark fallbacks
 }
 
-int32 lua_collectgarbage(int32 limit) {
-	int32 recovered = nblocks;  // to subtract nblocks after gc
-	Hash *freetable;
-	TaggedString *freestr;
-	TProtoFunc *freefunc;
-	Closure *freeclos;
+// Traverses the last gray object, returning the work it took
+static int32 propagatemark() {
+	TObject o = graylist[--graytop];  // the list may grow meanwhile
+	switch (ttype(&o)) {
+	case LUA_T_ARRAY:
+		return hashmark(avalue(&o));
+	case LUA_T_CLOSURE:
+		return closuremark(o.value.cl);
+	default:
+		return protomark(o.value.tf);
+	}
+}
+
+static void startcycle() {
+	gcphase = GC_MARK;
+	graytop = 0;
+	markall();
+}
+
+// Ends the mark phase in one go: what changed since the roots were
+// marked is found by marking them again
+static void atomic() {
+	int32 i;
 	markall();
+	while (graytop > 0)
+		propagatemark();
 	invalidaterefs();
-	freestr = luaS_collector();
-	freetable = (Hash *)listcollect(&roottable);
-	freefunc = (TProtoFunc *)listcollect(&rootproto);
-	freeclos = (Closure *)listcollect(&rootcl);
-	GCthreshold *= 4;  // to avoid GC during GC
-	luaC_hashcallIM(freetable);  // GC tag methods for tables
+	luaS_sweepglobals();
+
+	// Objects created from now on go in fresh lists which aren't swept
+	sweeplists[0].root = &roottable;
+	sweeplists[1].root = &rootproto;
+	sweeplists[2].root = &rootcl;
+	for (i = 0; i < NUM_SWEEPLISTS; i++) {
+		SweepList *l = &sweeplists[i];
+		l->pending = l->root->next;
+		l->root->next = NULL;
+		l->kept = l->keptTail = NULL;
+	}
+	sweepstring = 0;
+	sweeplist = 0;
+	gcphase = GC_SWEEP;
+}
+
+static int32 sweepnodes(SweepList *l, int32 work, GCnode **frees) {
+	int32 done = 0;
+	while (l->pending && done < work) {
+		GCnode *n = l->pending;
+		l->pending = n->next;
+		if (n->marked) {
+			n->marked = GC_WHITE;
+			n->next = NULL;
+			if (l->keptTail)
+				l->keptTail->next = n;
+			else
+				l->kept = n;
+			l->keptTail = n;
+		} else {
+			n->next = *frees;
+			*frees = n;
+		}
+		done++;
+	}
+	return done;
+}
+
+// Puts the swept objects, and the ones not swept yet, back in the list
+static void restorelist(SweepList *l) {
+	GCnode *head = l->kept, *tail = l->keptTail;
+	if (tail)
+		tail->next = l->pending;
+	else
+		head = l->pending;
+	if (!head)
+		return;
+	if (!tail || l->pending)
+		for (tail = head; tail->next; tail = tail->next)
+			;
+	tail->next = l->root->next;
+	l->root->next = head;
+	l->pending = l->kept = l->keptTail = NULL;
+}
+
+// Does about work units of collection, returning whether the cycle ended
+static int32 gcstep(int32 work) {
+	GCnode *frees[NUM_SWEEPLISTS] = { NULL, NULL, NULL };
+	TaggedString *freestr = NULL;
+	int32 finished = 0;
+
+	gcbusy = 1;
+	while (work > 0 && gcphase != GC_IDLE) {
+		if (gcphase == GC_MARK) {
+			if (graytop > 0)
+				work -= propagatemark();
+			else
+				atomic();
+		} else if (sweepstring < NUM_HASHS) {
+			work -= luaS_sweep(sweepstring++, &freestr);
+		} else if (sweeplist < NUM_SWEEPLISTS) {
+			SweepList *l = &sweeplists[sweeplist];
+			work -= sweepnodes(l, work, &frees[sweeplist]);
+			if (!l->pending) {
+				restorelist(l);
+				sweeplist++;
+			}
+		} else {
+			gcphase = GC_IDLE;
+			finished = 1;
+		}
+	}
+	gcbusy = 0;
+
+	luaC_hashcallIM((Hash *)frees[0]);  // GC tag methods for tables
 	luaC_strcallIM(freestr);  // GC tag methods for userdata
-	luaD_gcIM(&luaO_nilobject);  // GC tag method for nil (signal end of GC)
-	luaH_free(freetable);
+	if (finished)
+		luaD_gcIM(&luaO_nilobject);  // GC tag method for nil (signal end of GC)
+	luaH_free((Hash *)frees[0]);
 	luaS_free(freestr);
-	luaF_freeproto(freefunc);
-	luaF_freeclosure(freeclos);
+	luaF_freeproto((TProtoFunc *)frees[1]);
+	luaF_freeclosure((Closure *)frees[2]);
+	if (finished)
+		GCthreshold = 2 * nblocks;
+	return finished;
+}
+
+void luaC_barrier(Hash *t) {
+	if (gcphase == GC_MARK) {
+		Value v;
+		v.a = t;
+		t->head.marked = GC_GRAY;
+		pushgray(LUA_T_ARRAY, v);
+	}
+}
+
+int32 luaC_sweeping() {
+	return gcphase == GC_SWEEP;
+}
+
+void luaC_reset() {
+	int32 i;
+	if (gcphase == GC_SWEEP) {
+		for (i = 0; i < NUM_SWEEPLISTS; i++)
+			restorelist(&sweeplists[i]);
+	}
+	gcphase = GC_IDLE;
+	luaM_free(graylist);
+	graylist = NULL;
+	graysize = 0;
+	graytop = 0;
+}
+
+int32 lua_collectgarbage(int32 limit) {
+	int32 recovered = nblocks;  // to subtract nblocks after gc
+	if (gcbusy)
+		return 0;
+	// finish the cycle in progress, then run a whole one
+	while (gcphase != GC_IDLE)
+		gcstep(MAX_INT);
+	startcycle();
+	while (gcphase != GC_IDLE)
+		gcstep(MAX_INT);
 	recovered = recovered - nblocks;
 	GCthreshold = (limit == 0) ? 2 * nblocks : nblocks + limit;
 	return recovered;
 }
 
+void lua_stepgarbage(int32 start) {
+	if (gcbusy)
+		return;
+	if (gcphase == GC_IDLE) {
+		if (!start)
+			return;
+		startcycle();
+	}
+	gcstep(GARBAGE_STEP);
+}
+
 void luaC_checkGC() {
-	if (nblocks >= GCthreshold)
-		lua_collectgarbage(0);
+	if (nblocks >= GCthreshold && !gcbusy) {
+		if (gcphase == GC_IDLE)
+			startcycle();
+		// step again after a few more allocations, the end of the
+		// cycle sets the threshold back
+		GCthreshold = nblocks + GARBAGE_BLOCK;
+		gcstep(GARBAGE_STEP);
+	}
 }
 
 } // end of namespace Grim
@@ -12,7 +12,16 @@
 
 namespace Grim {
 
+// Marks of tables, closures and protos while collecting: white objects
+// weren't reached yet, gray ones wait to be traversed
+#define GC_WHITE	0
+#define GC_GRAY		1
+#define GC_BLACK	2
+
 void luaC_checkGC();
+void luaC_barrier(Hash *t);
+int32 luaC_sweeping();
+void luaC_reset();
 TObject* luaC_getref(int32 ref);
 int32 luaC_ref(TObject *o, int32 lock);
 void luaC_hashcallIM(Hash *l);
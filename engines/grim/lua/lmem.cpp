@@ -5,6 +5,9 @@
 */
 
 
+#include "common/memorypool.h"
+#include "common/util.h"
+
 #include "engines/grim/lua/lmem.h"
 #include "engines/grim/lua/lstate.h"
 #include "engines/grim/lua/lua.h"
@@ -23,21 +26,122 @@ int32 luaM_growaux(void **block, int32 nelems, int32 size, const char *errormsg,
 
 #ifndef LUA_DEBUG
 
+/*
+** Small blocks come from pools of a few sizes, which are much cheaper
+** than malloc for the strings, tables, closures and tasks the scripts
+** keep creating and dropping. Every block starts with a header telling
+** which pool it belongs to.
+*/
+
+struct BlockHeader {
+	int32 sizeClass;  // index of the pool, -1 for malloc
+	int32 size;
+};
+
+class LuaMemoryPool : public Common::MemoryPool {
+public:
+	explicit LuaMemoryPool(int32 size) :
+		Common::MemoryPool(sizeof(BlockHeader) + size), _size(size), _live(0), _peak(0) { }
+
+	void *alloc() {
+		if (++_live > _peak)
+			_peak = _live;
+		return allocChunk();
+	}
+	void release(void *ptr) {
+		_live--;
+		freeChunk(ptr);
+	}
+
+	int32 _size;
+	int32 _live, _peak;  // blocks in use
+};
+
+#define NUM_POOLS		10
+#define MAX_POOLED		256
+
+static LuaMemoryPool pool8(8), pool16(16), pool24(24), pool32(32), pool48(48),
+	pool64(64), pool96(96), pool128(128), pool192(192), pool256(256);
+static LuaMemoryPool *const pools[NUM_POOLS] = {
+	&pool8, &pool16, &pool24, &pool32, &pool48, &pool64, &pool96, &pool128, &pool192, &pool256
+};
+
+// pool for each size, in steps of 8 bytes
+static const int8 sizeClasses[MAX_POOLED / 8 + 1] = {
+	0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7,
+	8, 8, 8, 8, 8, 8, 8, 8, 9, 9, 9, 9, 9, 9, 9, 9
+};
+
+static int32 largeLive = 0, largePeak = 0;
+
+static int32 sizeclass(int32 size) {
+	return size <= MAX_POOLED ? sizeClasses[(size + 7) / 8] : -1;
+}
+
+static void *allocblock(int32 size) {
+	int32 c = sizeclass(size);
+	BlockHeader *h;
+	if (c >= 0)
+		h = (BlockHeader *)pools[c]->alloc();
+	else {
+		h = (BlockHeader *)malloc(sizeof(BlockHeader) + size);
+		if (!h)
+			lua_error(memEM);
+		if (++largeLive > largePeak)
+			largePeak = largeLive;
+	}
+	h->sizeClass = c;
+	h->size = size;
+	return h + 1;
+}
+
+static void freeblock(BlockHeader *h) {
+	if (h->sizeClass >= 0)
+		pools[h->sizeClass]->release(h);
+	else {
+		largeLive--;
+		free(h);
+	}
+}
+
 /*
 ** generic allocation routine.
-** real ANSI systems do not need some of these tests,
-** since realloc(NULL, s)==malloc(s) and realloc(b, 0)==free(b).
-** But some systems (e.g. Sun OS) are not that ANSI...
 */
 void *luaM_realloc(void *block, int32 size) {
+	if (!block)
+		return size == 0 ? NULL : allocblock(size);
+
+	BlockHeader *h = (BlockHeader *)block - 1;
 	if (size == 0) {
-		free(block);
+		freeblock(h);
 		return NULL;
 	}
-	block = block ? realloc(block, size) : malloc(size);
-	if (!block)
-		lua_error(memEM);
-	return block;
+	int32 c = sizeclass(size);
+	if (c == h->sizeClass) {
+		if (c < 0) {
+			h = (BlockHeader *)realloc(h, sizeof(BlockHeader) + size);
+			if (!h)
+				lua_error(memEM);
+		}
+		h->size = size;
+		return h + 1;
+	}
+	void *newblock = allocblock(size);
+	memcpy(newblock, block, MIN(size, h->size));
+	freeblock(h);
+	return newblock;
+}
+
+void luaM_printstats() {
+	for (int32 i = 0; i < NUM_POOLS; i++)
+		printf("lua pool %3d bytes: %d blocks, %d at most\n", pools[i]->_size, pools[i]->_live, pools[i]->_peak);
+	printf("lua large blocks: %d blocks, %d at most\n", largeLive, largePeak);
+}
+
+// Gives back the pages of the pools once the state is closed
+void luaM_freepools() {
+	for (int32 i = 0; i < NUM_POOLS; i++)
+		pools[i]->freeUnusedPages();
 }
 
 #else
@@ -83,6 +83,11 @@ void lua_stateinit(LState *state) {
 	state->task = NULL;
 	state->some_task = NULL;
 	state->taskFunc.ttype = LUA_T_NIL;
+	state->priority = 0;
+	state->deferred = 0;
+	state->runs = 0;
+	state->instructions = 0;
+	state->runTime = 0;
 
 	state->stack.stack = luaM_newvector(STACK_UNIT, TObject);
 	state->stack.top = state->stack.stack;
@@ -106,7 +111,7 @@ void lua_statedeinit(LState *state) {
 		}
 	}
 
-	free(state->stack.stack);
+	luaM_free(state->stack.stack);
 }
 
 void lua_resetglobals() {
@@ -203,6 +208,7 @@ void lua_open() {
 }
 
 void lua_close() {
+	luaC_reset();
 	TaggedString *alludata = luaS_collectudata();
 	GCthreshold = MAX_INT;  // to avoid GC during GC
 	luaC_hashcallIM((Hash *)roottable.next);  // GC t.methods for tables
@@ -230,6 +236,10 @@ void lua_close() {
 	refArray = NULL;
 	lua_rootState = lua_state = NULL;
 
+	if (gDebugLevel == DEBUG_LUA || gDebugLevel == DEBUG_ALL)
+		luaM_printstats();
+	luaM_freepools();
+
 #ifdef DEBUG
 	printf("total de blocos: %ld\n", numblocks);
 	printf("total de memoria: %ld\n", totalmem);
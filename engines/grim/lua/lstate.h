@@ -15,6 +15,7 @@ namespace Grim {
 
 #define MAX_C_BLOCKS 10
 #define GARBAGE_BLOCK 150
+#define GARBAGE_STEP 2048  // work done by each step of the collector
 
 typedef int32 StkId;  /* index to stack elements */
 
@@ -91,6 +92,11 @@ struct LState {
 	TObject	taskFunc;
 	struct C_Lua_Stack Cblocks[MAX_C_BLOCKS];
 	int numCblocks; // number of nested Cblocks
+	int32 priority; // below 0 the task may be put off when a frame runs late
+	int32 deferred; // task was put off in the last frame
+	uint32 runs; // frames the task ran in
+	uint32 instructions; // opcodes executed
+	uint32 runTime; // milliseconds spent running it
 };
 
 extern LState *lua_state, *lua_rootState;
@@ -6,6 +6,7 @@
 
 #include "common/util.h"
 
+#include "engines/grim/lua/lgc.h"
 #include "engines/grim/lua/lmem.h"
 #include "engines/grim/lua/lobject.h"
 #include "engines/grim/lua/lstate.h"
@@ -83,7 +84,7 @@ static TaggedString *newone(const char *buff, int32 tag, uint32 h) {
 		ts->constindex = -1;  /* tag -> this is a userdata */
 		nblocks++;
 	}
-	ts->head.marked = 0;
+	ts->head.marked = luaC_sweeping();  // tables not swept yet must keep it
 	ts->head.next = (GCnode *)ts;  // signal it is in no list
 	ts->hash = h;
 	return ts;
@@ -104,8 +105,12 @@ static TaggedString *insert(const char *buff, int32 tag, stringtable *tb) {
 			j = i;
 		else if ((ts->constindex >= 0) ? // is a string?
 				(tag == LUA_T_STRING && (strcmp(buff, ts->str) == 0)) :
-				((tag == ts->globalval.ttype || tag == LUA_ANYTAG) && buff == (const char *)ts->globalval.value.ts))
+				((tag == ts->globalval.ttype || tag == LUA_ANYTAG) && buff == (const char *)ts->globalval.value.ts)) {
+			// A dead string in a table not swept yet is in use again
+			if (!ts->head.marked && luaC_sweeping())
+				ts->head.marked = 1;
 			return ts;
+		}
 		if (++i == size)
 			i = 0;
 	}
@@ -136,7 +141,7 @@ TaggedString *luaS_new(const char *str) {
 
 TaggedString *luaS_newfixedstring(const char *str) {
 	TaggedString *ts = luaS_new(str);
-	if (ts->head.marked == 0)
+	if (ts->head.marked <= 1)
 		ts->head.marked = 2;  // avoid GC
 	return ts;
 }
@@ -163,27 +168,29 @@ static void remove_from_list(GCnode *l) {
 	}
 }
 
-TaggedString *luaS_collector() {
-	TaggedString *frees = NULL;
-	int32 i;
+void luaS_sweepglobals() {
 	remove_from_list(&rootglobal);
-	for (i = 0; i < NUM_HASHS; i++) {
-		stringtable *tb = &string_root[i];
-		int32 j;
-		for (j = 0; j < tb->size; j++) {
-			TaggedString *t = tb->hash[j];
-			if (!t)
-				continue;
-			if (t->head.marked == 1)
-				t->head.marked = 0;
-			else if (!t->head.marked) {
-				t->head.next = (GCnode *)frees;
-				frees = t;
-				tb->hash[j] = &EMPTY;
-			}
+}
+
+// Sweeps the string table i, chaining the dead strings in front of
+// *frees, and returns the work done. A table is always swept whole, as
+// inserting a string in it may rehash it.
+int32 luaS_sweep(int32 i, TaggedString **frees) {
+	stringtable *tb = &string_root[i];
+	int32 j;
+	for (j = 0; j < tb->size; j++) {
+		TaggedString *t = tb->hash[j];
+		if (!t)
+			continue;
+		if (t->head.marked == 1)
+			t->head.marked = 0;
+		else if (!t->head.marked) {
+			t->head.next = (GCnode *)*frees;
+			*frees = t;
+			tb->hash[j] = &EMPTY;
 		}
 	}
-	return frees;
+	return 1 + tb->size;
 }
 
 TaggedString *luaS_collectudata() {
@@ -14,7 +14,8 @@ namespace Grim {
 
 void luaS_init();
 TaggedString *luaS_createudata(void *udata, int32 tag);
-TaggedString *luaS_collector();
+void luaS_sweepglobals();
+int32 luaS_sweep(int32 i, TaggedString **frees);
 void luaS_free (TaggedString *l);
 TaggedString *luaS_new(const char *str);
 TaggedString *luaS_newfixedstring (const char *str);
@@ -5,6 +5,7 @@
 */
 
 #include "engines/grim/lua/lauxlib.h"
+#include "engines/grim/lua/lgc.h"
 #include "engines/grim/lua/lmem.h"
 #include "engines/grim/lua/lobject.h"
 #include "engines/grim/lua/lstate.h"
@@ -197,6 +198,8 @@ TObject *luaH_get(Hash *t, TObject *ref) {
 */
 TObject *luaH_set(Hash *t, TObject *ref) {
 	Node *n = node(t, present(t, ref));
+	if (t->head.marked == GC_BLACK)
+		luaC_barrier(t);  // the new value may not be marked yet
 	if (ttype(ref(n)) == LUA_T_NIL) {
 		nuse(t)++;
 		if ((float)nuse(t) > (float)nhash(t) * REHASH_LIMIT) {
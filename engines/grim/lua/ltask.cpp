@@ -1,4 +1,8 @@
 
+#include "common/hashmap.h"
+#include "common/str.h"
+#include "common/system.h"
+
 #include "engines/grim/lua/ltask.h"
 #include "engines/grim/lua/lapi.h"
 #include "engines/grim/lua/lauxlib.h"
@@ -8,6 +12,64 @@
 
 namespace Grim {
 
+// What the finished tasks of a script cost, gathered while script_stats
+// is collecting
+struct ScriptStats {
+	uint32 tasks;
+	uint32 runs;
+	uint32 instructions;
+	uint32 runTime;
+};
+
+typedef Common::HashMap<Common::String, ScriptStats> ScriptStatsMap;
+
+static ScriptStatsMap finishedScripts;
+static bool collectStats = false;
+static int32 taskBudget = 0;  // milliseconds per frame, 0 means no limit
+
+static Common::String scriptName(LState *state) {
+	TObject *f = &state->taskFunc;
+	if (ttype(f) == LUA_T_PROTO) {
+		TProtoFunc *tf = tfvalue(f);
+		return Common::String::format("%s:%d", tf->fileName ? tf->fileName->str : "?", tf->lineDefined);
+	} else if (ttype(f) == LUA_T_CPROTO)
+		return Common::String::format("C function %p", (void *)fvalue(f));
+	return "?";
+}
+
+// Adds the cost of a task about to be freed to the one of its script
+static void retireTask(LState *state) {
+	if (!collectStats)
+		return;
+	Common::String name = scriptName(state);
+	if (!finishedScripts.contains(name)) {
+		ScriptStats empty = { 0, 0, 0, 0 };
+		finishedScripts[name] = empty;
+	}
+	ScriptStats &stats = finishedScripts[name];
+	stats.tasks++;
+	stats.runs += state->runs;
+	stats.instructions += state->instructions;
+	stats.runTime += state->runTime;
+}
+
+void lua_settaskbudget(int32 msecs) {
+	taskBudget = msecs;
+}
+
+// Once the tasks took longer than the budget in a frame, the background
+// ones left are put off to the next frame, though never twice in a row
+static bool deferTask(LState *state, uint32 frameStart) {
+	if (taskBudget <= 0 || state->priority >= 0)
+		return false;
+	if (state->deferred || g_system->getMillis() - frameStart < (uint32)taskBudget) {
+		state->deferred = 0;
+		return false;
+	}
+	state->deferred = 1;
+	return true;
+}
+
 void lua_taskinit(lua_Task *task, lua_Task *next, StkId tbase, int results) {
 	task->some_flag = 0;
 	task->next = next;
@@ -114,6 +176,7 @@ void stop_script() {
 		}
 		if (state) {
 			if (state != lua_state) {
+				retireTask(state);
 				lua_statedeinit(state);
 				luaM_free(state);
 			}
@@ -128,6 +191,7 @@ void stop_script() {
 			}
 			if (match && state != lua_state) {
 				LState *tmp = state->next;
+				retireTask(state);
 				lua_statedeinit(state);
 				luaM_free(state);
 				state = tmp;
@@ -229,8 +293,52 @@ void current_script() {
 
 void break_here() {}
 
+void set_script_priority() {
+	lua_Object paramObj = lua_getparam(1);
+
+	if (paramObj == LUA_NOOBJECT || ttype(Address(paramObj)) != LUA_T_TASK)
+		lua_error("Bad argument to set_script_priority");
+
+	uint32 task = (uint32)nvalue(Address(paramObj));
+	int32 priority = (int32)luaL_check_number(2);
+	LState *state;
+	for (state = lua_rootState->next; state != NULL; state = state->next) {
+		if (state->id == task) {
+			state->priority = priority;
+			return;
+		}
+	}
+}
+
+// Prints what the running tasks and the finished scripts cost so far.
+// script_stats(1) starts gathering the finished scripts, script_stats(0)
+// stops and forgets them.
+void script_stats() {
+	lua_Object paramObj = lua_getparam(1);
+
+	if (paramObj != LUA_NOOBJECT) {
+		collectStats = luaL_check_number(1) != 0;
+		finishedScripts.clear();
+		return;
+	}
+
+	printf("running tasks:\n");
+	for (LState *state = lua_rootState->next; state != NULL; state = state->next) {
+		printf("%5u %-40s priority %d, %u frames, %u instructions, %u ms\n", state->id, scriptName(state).c_str(),
+			   state->priority, state->runs, state->instructions, state->runTime);
+	}
+	if (!collectStats)
+		return;
+	printf("finished scripts:\n");
+	for (ScriptStatsMap::const_iterator i = finishedScripts.begin(); i != finishedScripts.end(); ++i) {
+		printf("%-46s %u tasks, %u frames, %u instructions, %u ms\n", i->_key.c_str(), i->_value.tasks,
+			   i->_value.runs, i->_value.instructions, i->_value.runTime);
+	}
+}
+
 void lua_runtasks() {
 	int32 flag;
+	uint32 frameStart = g_system->getMillis();
 	LState *tmpState = lua_state;
 	LState *state = lua_state->next;
 	if (state) {
@@ -243,7 +351,10 @@ loop:
 		lua_state = lua_state->next;
 		if (lua_state) {
 			while (1) {
+				if (!lua_state->flag2 && !lua_state->paused && deferTask(lua_state, frameStart))
+					lua_state->flag2 = 1;
 				if (!lua_state->flag2 && !lua_state->paused) {
+					uint32 runStart = g_system->getMillis();
 					jmp_buf	errorJmp;
 					lua_state->errorJmp = &errorJmp;
 					if (setjmp(errorJmp)) {
@@ -265,8 +376,11 @@ loop:
 							flag = luaD_call(base + 1, 255);
 						}
 					}
+					lua_state->runs++;
+					lua_state->runTime += g_system->getMillis() - runStart;
 					if (!flag) {
 						state = lua_state->next;
+						retireTask(lua_state);
 						lua_statedeinit(lua_state);
 						luaM_free(lua_state);
 						goto label2;
@@ -32,6 +32,8 @@ void pause_scripts();
 void unpause_scripts();
 void find_script();
 void break_here();
+void set_script_priority();
+void script_stats();
 
 } // end of namespace Grim
 
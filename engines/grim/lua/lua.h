@@ -147,8 +147,10 @@ void lua_unref(int32 ref);
 
 lua_Object lua_createtable();
 int32 lua_collectgarbage(int32 limit);
+void lua_stepgarbage(int32 start);
 
 void lua_runtasks();
+void lua_settaskbudget(int32 msecs);
 void current_script();
 
 /* some useful macros/derived functions */
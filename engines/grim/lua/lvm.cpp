@@ -253,7 +253,9 @@ StkId luaV_execute(lua_Task *task) {
 	}
 	lua_state->state_counter2++;
 
+	uint32 executed = 0;
 	while (1) {
+		executed++;
 		switch ((OpCode)(task->aux = *task->pc++)) {
 		case PUSHNIL0:
 			ttype(task->S->top++) = LUA_T_NIL;
@@ -654,12 +656,14 @@ closure:
 			task->aux -= CALLFUNC0;
 callfunc:
 			lua_state->state_counter2--;
+			lua_state->instructions += executed;
 			return -((task->S->top - task->S->stack) - (*task->pc++));
 		case ENDCODE:
 			task->S->top = task->S->stack + task->base;
 			// goes through
 		case RETCODE:
 			lua_state->state_counter2--;
+			lua_state->instructions += executed;
 			return (task->base + ((task->aux == 123) ? *task->pc : 0));
 		case SETLINEW:
 			task->aux = next_word(task->pc);
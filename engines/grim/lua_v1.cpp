@@ -2451,6 +2451,14 @@ static void MakeCurrentSet() {
 	g_grim->setScene(name);
 }
 
+static void PreloadScene() {
+	lua_Object nameObj = lua_getparam(1);
+	if (!lua_isstring(nameObj))
+		return;
+
+	g_resourceloader->preloadScene(lua_getstring(nameObj));
+}
+
 static void MakeCurrentSetup() {
 	lua_Object setupObj = lua_getparam(1);
 	if (!lua_isnumber(setupObj))
@@ -4184,6 +4192,7 @@ struct luaL_reg mainOpcodes[] = {
 	{ "PrintWarning", PrintWarning },
 	{ "PrintDebug", PrintDebug },
 	{ "MakeCurrentSet", MakeCurrentSet },
+	{ "PreloadScene", PreloadScene },
 	{ "LockSet", LockSet },
 	{ "UnLockSet", UnLockSet },
 	{ "MakeCurrentSetup", MakeCurrentSetup },
@@ -154,6 +154,8 @@ void Model::Mesh::loadBinary(const char *&data, Material *materials[]) {
 	_shadow = READ_LE_UINT32(data);
 	_radius = get_float(data + 8);
 	data += 36;
+	computeBounds();
+	compile();
 }
 
 Model::Mesh::~Mesh() {
@@ -163,11 +165,106 @@ Model::Mesh::~Mesh() {
 	delete[] _textureVerts;
 	delete[] _faces;
 	delete[] _materialid;
+	delete[] _runs;
+	delete[] _runVertices;
+	delete[] _runNormals;
+	delete[] _runTextureVerts;
+	delete[] _runFaceStart;
+	delete[] _runFaceSize;
+	delete[] _runIndices;
 }
 
 void Model::Mesh::update() {
 }
 
+// The box covers the vertices used by the faces, which are the ones the
+// screen bounds of the mesh are computed from.
+void Model::Mesh::computeBounds() {
+	float min[3] = { 0, 0, 0 }, max[3] = { 0, 0, 0 };
+	bool first = true;
+
+	for (int i = 0; i < _numFaces; i++) {
+		for (int j = 0; j < _faces[i]._numVertices; j++) {
+			const float *v = _vertices + 3 * _faces[i]._vertices[j];
+			for (int k = 0; k < 3; k++) {
+				if (first || v[k] < min[k])
+					min[k] = v[k];
+				if (first || v[k] > max[k])
+					max[k] = v[k];
+			}
+			first = false;
+		}
+	}
+
+	for (int i = 0; i < 8; i++) {
+		_bounds[3 * i] = (i & 1) ? max[0] : min[0];
+		_bounds[3 * i + 1] = (i & 2) ? max[1] : min[1];
+		_bounds[3 * i + 2] = (i & 4) ? max[2] : min[2];
+	}
+}
+
+// Groups the faces by material, keeping their order inside a group, so that
+// drawing the mesh selects each material once.
+void Model::Mesh::compile() {
+	int numRunVertices = 0, numIndices = 0;
+	for (int i = 0; i < _numFaces; i++) {
+		numRunVertices += _faces[i]._numVertices;
+		if (_faces[i]._numVertices >= 3)
+			numIndices += 3 * (_faces[i]._numVertices - 2);
+	}
+
+	_runs = new FaceRun[_numFaces];
+	_runVertices = new float[3 * numRunVertices];
+	_runNormals = new float[3 * numRunVertices];
+	_runTextureVerts = new float[2 * numRunVertices];
+	_runFaceStart = new int[_numFaces];
+	_runFaceSize = new int[_numFaces];
+	_runIndices = new int[numIndices];
+	_numRuns = 0;
+
+	bool *done = new bool[_numFaces];
+	memset(done, 0, _numFaces * sizeof(bool));
+	int face = 0, vertex = 0, index = 0;
+	for (int i = 0; i < _numFaces; i++) {
+		if (done[i])
+			continue;
+
+		FaceRun &run = _runs[_numRuns++];
+		run._face = &_faces[i];
+		run._textured = _faces[i]._texVertices != NULL;
+		run._firstFace = face;
+		run._firstIndex = index;
+		for (int j = i; j < _numFaces; j++) {
+			const Face &f = _faces[j];
+			if (done[j] || _materialid[j] != _materialid[i] || (f._texVertices != NULL) != run._textured)
+				continue;
+			done[j] = true;
+
+			_runFaceStart[face] = vertex;
+			_runFaceSize[face] = f._numVertices;
+			face++;
+			// same vertex order and winding as the polygon
+			for (int k = 1; k + 1 < f._numVertices; k++) {
+				_runIndices[index++] = vertex;
+				_runIndices[index++] = vertex + k;
+				_runIndices[index++] = vertex + k + 1;
+			}
+			for (int k = 0; k < f._numVertices; k++) {
+				memcpy(_runVertices + 3 * vertex, _vertices + 3 * f._vertices[k], 3 * sizeof(float));
+				memcpy(_runNormals + 3 * vertex, _vertNormals + 3 * f._vertices[k], 3 * sizeof(float));
+				if (f._texVertices)
+					memcpy(_runTextureVerts + 2 * vertex, _textureVerts + 2 * f._texVertices[k], 2 * sizeof(float));
+				else
+					_runTextureVerts[2 * vertex] = _runTextureVerts[2 * vertex + 1] = 0.f;
+				vertex++;
+			}
+		}
+		run._numFaces = face - run._firstFace;
+		run._numIndices = index - run._firstIndex;
+	}
+	delete[] done;
+}
+
 void Model::Face::changeMaterial(Material *material) {
 	_material = material;
 }
@@ -480,6 +577,8 @@ void Model::Mesh::loadText(TextSplitter *ts, Material* materials[]) {
 		ts->scanString(" %d: %f %f %f", 4, &num, &x, &y, &z);
 		_faces[num]._normal = Graphics::Vector3d(x, y, z);
 	}
+	computeBounds();
+	compile();
 }
 
 void Model::HierNode::draw() const {
@@ -508,12 +607,43 @@ void Model::HierNode::setMatrix(Graphics::Matrix4 matrix) {
 	_matrix = matrix;
 }
 
+// The matrix is passed down the chain of first children, in a single pass.
 void Model::HierNode::update() {
-	if (!_initialized)
+	HierNode *node = this;
+
+	while (node && node->_initialized) {
+		node->updateMatrices();
+		if (node->_child)
+			node->_child->setMatrix(node->_matrix);
+		node = node->_child;
+	}
+}
+
+// Turns _matrix, holding the parent matrix, into the one of this node.
+void Model::HierNode::updateMatrices() {
+	Graphics::Vector3d pos = _animPos / _totalWeight;
+	float pitch = _animPitch / _totalWeight;
+	float yaw = _animYaw / _totalWeight;
+	float roll = _animRoll / _totalWeight;
+
+	bool poseChanged = !_matricesValid || pos != _lastPos || pitch != _lastPitch || yaw != _lastYaw || roll != _lastRoll;
+	if (!poseChanged && _matrix == _lastParentMatrix) {
+		_matrix = _lastMatrix;
+		// the mesh may be shared with other copies of the hierarchy
+		if (_mesh)
+			_mesh->_matrix = _pivotMatrix;
 		return;
+	}
 
-	_localMatrix._pos.set(_animPos.x() / _totalWeight, _animPos.y() / _totalWeight, _animPos.z() / _totalWeight);
-	_localMatrix._rot.buildFromPitchYawRoll(_animPitch / _totalWeight, _animYaw / _totalWeight, _animRoll / _totalWeight);
+	if (poseChanged) {
+		_localMatrix._pos = pos;
+		_localMatrix._rot.buildFromPitchYawRoll(pitch, yaw, roll);
+		_lastPos = pos;
+		_lastPitch = pitch;
+		_lastYaw = yaw;
+		_lastRoll = roll;
+	}
+	_lastParentMatrix = _matrix;
 
 	_matrix *= _localMatrix;
 
@@ -525,10 +655,8 @@ void Model::HierNode::update() {
 		_mesh->_matrix = _pivotMatrix;
 	}
 
-	if (_child) {
-		_child->setMatrix(_matrix);
-		_child->update();
-	}
+	_lastMatrix = _matrix;
+	_matricesValid = true;
 }
 
 void Model::Mesh::draw() const {
@@ -541,13 +669,10 @@ void Model::Mesh::draw() const {
 		g_winY2 = MAX(g_winY2, winY2);
 	}
 
-	for (int i = 0; i < _numFaces; i++)
-		_faces[i].draw(_vertices, _vertNormals, _textureVerts);
-}
-
-void Model::Face::draw(float *vertices, float *vertNormals, float *textureVerts) const {
-	_material->select();
-	g_driver->drawModelFace(this, vertices, vertNormals, textureVerts);
+	for (int i = 0; i < _numRuns; i++) {
+		_runs[i]._face->_material->select();
+		g_driver->drawModelFaces(this, &_runs[i]);
+	}
 }
 
 } // end of namespace Grim
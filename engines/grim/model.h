@@ -52,7 +52,7 @@ public:
 	struct Geoset;
 	struct Mesh;
 	struct HierNode {
-		HierNode() : _initialized(false) { }
+		HierNode() : _initialized(false), _matricesValid(false) { }
 		~HierNode();
 		void loadBinary(const char *&data, HierNode *hierNodes, const Geoset *g);
 		void draw() const;
@@ -60,6 +60,7 @@ public:
 		void removeChild(HierNode *child);
 		void setMatrix(Graphics::Matrix4 matrix);
 		void update();
+		void updateMatrices();
 
 		char _name[64];
 		Mesh *_mesh;
@@ -76,6 +77,14 @@ public:
 		Graphics::Matrix4 _matrix;
 		Graphics::Matrix4 _localMatrix;
 		Graphics::Matrix4 _pivotMatrix;
+
+		// The inputs the matrices above were last built from. Nodes
+		// whose pose and parent matrix didn't change reuse them.
+		bool _matricesValid;
+		Graphics::Vector3d _lastPos;
+		float _lastPitch, _lastYaw, _lastRoll;
+		Graphics::Matrix4 _lastParentMatrix;
+		Graphics::Matrix4 _lastMatrix;
 	};
 
 	HierNode *copyHierarchy();
@@ -84,7 +93,6 @@ public:
 //private:
 	struct Face {
 		int loadBinary(const char *&data, Material *materials[]);
-		void draw(float *vertices, float *vertNormals, float *textureVerts) const;
 		void changeMaterial(Material *material);
 		~Face();
 
@@ -96,13 +104,25 @@ public:
 		Graphics::Vector3d _normal;
 	};
 
+	// Faces of a mesh sharing a material, drawn with a single selection
+	// of it. They are laid out contiguously in the arrays of the mesh.
+	struct FaceRun {
+		Face *_face;	// first face of the run, holds the current material
+		bool _textured;
+		int _firstFace, _numFaces;		// into _runFaceStart and _runFaceSize
+		int _firstIndex, _numIndices;	// triangles, into _runIndices
+	};
+
 	struct Mesh {
 		void loadBinary(const char *&data, Material *materials[]);
 		void loadText(TextSplitter *ts, Material *materials[]);
 		void changeMaterials(Material *materials[]);
 		void draw() const;
 		void update();
-		Mesh() : _numFaces(0) { }
+		void computeBounds();
+		void compile();
+		Mesh() : _numFaces(0), _numRuns(0), _runs(NULL), _runVertices(NULL), _runNormals(NULL),
+			_runTextureVerts(NULL), _runFaceStart(NULL), _runFaceSize(NULL), _runIndices(NULL) { }
 		~Mesh();
 
 		char _name[32];
@@ -121,6 +141,19 @@ public:
 		int _numFaces;
 		Face *_faces;
 		Graphics::Matrix4 _matrix;
+
+		float _bounds[24];	// corners of the local bounding box, sets of 3
+
+		// The faces grouped by material, with the attributes of each face
+		// vertex copied into flat arrays. Polygon i of the runs starts at
+		// vertex _runFaceStart[i] and has _runFaceSize[i] vertices.
+		int _numRuns;
+		FaceRun *_runs;
+		float *_runVertices;		// sets of 3
+		float *_runNormals;			// sets of 3
+		float *_runTextureVerts;	// sets of 2
+		int *_runFaceStart, *_runFaceSize;
+		int *_runIndices;			// the polygons split in triangle fans
 	};
 
 	struct Geoset {
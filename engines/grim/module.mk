@@ -6,6 +6,7 @@ MODULE_OBJS := \
 	imuse/imuse_music.o \
 	imuse/imuse_script.o \
 	imuse/imuse_sndmgr.o \
+	imuse/imuse_stream.o \
 	imuse/imuse_tables.o \
 	imuse/imuse_track.o \
 	lua/lapi.o \
@@ -23,6 +23,9 @@
  *
  */
 
+#include "common/config-manager.h"
+#include "common/timer.h"
+
 #include "engines/grim/resource.h"
 #include "engines/grim/colormap.h"
 #include "engines/grim/costume.h"
@@ -40,8 +43,11 @@ ResourceLoader *g_resourceloader = NULL;
 
 ResourceLoader::ResourceLoader() {
 	int lab_counter = 0;
-	_cacheDirty = false;
 	_cacheMemorySize = 0;
+	_cacheMemoryBudget = ConfMan.getInt("resource_cache_size");
+	_cacheHits = 0;
+	_cacheMisses = 0;
+	_cacheEvictions = 0;
 
 	Lab *l;
 	Common::ArchiveMemberList files;
@@ -84,58 +90,81 @@ ResourceLoader::ResourceLoader() {
 			}
 		}
 	}
+
+	buildFileIndex();
+
+	g_system->getTimerManager()->installTimerProc(prefetchTimerHandler, 10000, this);
 }
 
 ResourceLoader::~ResourceLoader() {
+	g_system->getTimerManager()->removeTimerProc(prefetchTimerHandler);
+
+	for (Common::List<ResourceCache>::const_iterator i = _prefetchDone.begin(); i != _prefetchDone.end(); ++i)
+		delete i->resPtr;
+
+	for (CacheList::const_iterator i = _cache.begin(); i != _cache.end(); ++i)
+		delete i->resPtr;
+
 	for (LabList::const_iterator i = _labs.begin(); i != _labs.end(); ++i)
 		delete *i;
 }
 
-const Lab *ResourceLoader::getLab(const char *filename) const {
-	for (LabList::const_iterator i = _labs.begin(); i != _labs.end(); ++i)
-		if ((*i)->fileExists(filename))
-			return *i;
+void ResourceLoader::buildFileIndex() {
+	_fileIndex.clear();
 
-	return NULL;
-}
+	// _labs is already in precedence order, so the first archive to
+	// provide a file wins
+	for (LabList::const_iterator i = _labs.begin(); i != _labs.end(); ++i) {
+		const Lab::LabMap &entries = (*i)->getEntries();
+		for (Lab::LabMap::const_iterator j = entries.begin(); j != entries.end(); ++j) {
+			if (_fileIndex.contains(j->_key))
+				continue;
 
-static int sortCallback(const void *entry1, const void *entry2) {
-	return strcasecmp(((ResourceLoader::ResourceCache *)entry1)->fname, ((ResourceLoader::ResourceCache *)entry2)->fname);
+			FileIndexEntry &file = _fileIndex[j->_key];
+			file.lab = *i;
+			file.entry = j->_value;
+		}
+	}
 }
 
-Block *ResourceLoader::getFileFromCache(const char *filename) {
-	ResourceLoader::ResourceCache *entry = getEntryFromCache(filename);
-	if (entry)
-		return entry->resPtr;
-	else
+const ResourceLoader::FileIndexEntry *ResourceLoader::findFile(const char *filename) const {
+	FileIndex::const_iterator i = _fileIndex.find(filename);
+	if (i == _fileIndex.end())
 		return NULL;
+
+	return &i->_value;
 }
 
-ResourceLoader::ResourceCache *ResourceLoader::getEntryFromCache(const char *filename) {
-	if (_cache.empty())
+Block *ResourceLoader::getFileFromCache(const char *filename) {
+	CacheMap::iterator entry = _cacheMap.find(filename);
+	if (entry == _cacheMap.end()) {
+		_cacheMisses++;
 		return NULL;
-
-	if (_cacheDirty) {
-		qsort(_cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-		_cacheDirty = false;
 	}
 
-	ResourceCache key;
-	key.fname = const_cast<char *>(filename);
+	_cacheHits++;
+
+	// Move the entry to the front of the list, it is now the most recently used
+	CacheList::iterator i = entry->_value;
+	if (i != _cache.begin()) {
+		_cache.push_front(*i);
+		_cache.erase(i);
+		entry->_value = _cache.begin();
+	}
 
-	return (ResourceLoader::ResourceCache *)bsearch(&key, _cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
+	return _cache.front().resPtr;
 }
 
 bool ResourceLoader::fileExists(const char *filename) const {
-	return getLab(filename) != NULL;
+	return findFile(filename) != NULL;
 }
 
 Block *ResourceLoader::getFileBlock(const char *filename) const {
-	const Lab *l = getLab(filename);
-	if (!l)
+	const FileIndexEntry *f = findFile(filename);
+	if (!f)
 		return NULL;
 	else
-		return l->getFileBlock(filename);
+		return f->lab->getFileBlock(f->entry);
 }
 
 Block *ResourceLoader::getBlock(const char *filename) {
@@ -146,6 +175,7 @@ Block *ResourceLoader::getBlock(const char *filename) {
         b = getFileBlock(fname.c_str());
 		if (b) {
 			putIntoCache(fname, b);
+			trimCache();
 		}
     }
 
@@ -153,39 +183,209 @@ Block *ResourceLoader::getBlock(const char *filename) {
 }
 
 LuaFile *ResourceLoader::openNewStreamLuaFile(const char *filename) const {
-	const Lab *l = getLab(filename);
+	const FileIndexEntry *f = findFile(filename);
 
-	if (!l)
+	if (!f)
 		return NULL;
 	else
-		return l->openNewStreamLua(filename);
+		return f->lab->openNewStreamLua(f->entry);
 }
 
-Common::File *ResourceLoader::openNewStreamFile(const char *filename) const {
-	const Lab *l = getLab(filename);
+Common::SeekableReadStream *ResourceLoader::openNewStreamFile(const char *filename) const {
+	const FileIndexEntry *f = findFile(filename);
 
-	if (!l)
+	if (!f)
 		return NULL;
 	else
-		return l->openNewStreamFile(filename);
+		return f->lab->openNewStreamFile(f->entry);
 }
 
 int ResourceLoader::fileLength(const char *filename) const {
-	const Lab *l = getLab(filename);
-	if (l)
-		return l->fileLength(filename);
+	const FileIndexEntry *f = findFile(filename);
+	if (f)
+		return f->entry.len;
 	else
 		return 0;
 }
 
 void ResourceLoader::putIntoCache(Common::String fname, Block *res) {
 	ResourceCache entry;
+	entry.fname = fname;
 	entry.resPtr = res;
-	entry.fname = new char[fname.size() + 1];
-	strcpy(entry.fname, fname.c_str());
+	entry.pins = 0;
+	entry.users = 0;
+	// Blocks pointing into a memory-mapped archive are charged as well,
+	// their pages stay resident once they have been read
 	_cacheMemorySize += res->len();
-	_cache.push_back(entry);
-	_cacheDirty = true;
+	_cache.push_front(entry);
+	_cacheMap[fname] = _cache.begin();
+}
+
+void ResourceLoader::removeFromCache(const Common::String &fname) {
+	CacheMap::iterator entry = _cacheMap.find(fname);
+	if (entry == _cacheMap.end())
+		return;
+
+	CacheList::iterator i = entry->_value;
+	_cacheMemorySize -= i->resPtr->len();
+	delete i->resPtr;
+	_cache.erase(i);
+	_cacheMap.erase(entry);
+}
+
+void ResourceLoader::trimCache() {
+	if (_cacheMemoryBudget <= 0)
+		return;
+
+	// Walk from the least recently used end, skipping blocks still being
+	// parsed or backing a loaded object. The most recent entry is never
+	// evicted since the caller is still about to use it.
+	CacheList::iterator i = _cache.end();
+	while (_cacheMemorySize > _cacheMemoryBudget && i != _cache.begin()) {
+		--i;
+		if (i == _cache.begin() || i->pins > 0 || i->users > 0)
+			continue;
+
+		Common::String fname = i->fname;
+		++i;
+		removeFromCache(fname);
+		_cacheEvictions++;
+	}
+}
+
+void ResourceLoader::pinBlock(const Common::String &fname) {
+	CacheMap::iterator entry = _cacheMap.find(fname);
+	if (entry != _cacheMap.end())
+		entry->_value->pins++;
+}
+
+void ResourceLoader::unpinBlock(const Common::String &fname) {
+	CacheMap::iterator entry = _cacheMap.find(fname);
+	if (entry != _cacheMap.end())
+		entry->_value->pins--;
+
+	trimCache();
+}
+
+void ResourceLoader::acquireBlock(const Common::String &fname) {
+	CacheMap::iterator entry = _cacheMap.find(fname);
+	if (entry != _cacheMap.end())
+		entry->_value->users++;
+}
+
+void ResourceLoader::releaseBlock(const char *fname) {
+	CacheMap::iterator entry = _cacheMap.find(fname);
+	if (entry != _cacheMap.end() && entry->_value->users > 0)
+		entry->_value->users--;
+}
+
+void ResourceLoader::setCacheBudget(int32 bytes) {
+	_cacheMemoryBudget = bytes;
+	trimCache();
+}
+
+void ResourceLoader::getCacheStats(CacheStats &stats) const {
+	stats.hits = _cacheHits;
+	stats.misses = _cacheMisses;
+	stats.evictions = _cacheEvictions;
+	stats.entries = _cacheMap.size();
+	stats.memorySize = _cacheMemorySize;
+	stats.memoryBudget = _cacheMemoryBudget;
+}
+
+void ResourceLoader::preloadScene(const char *sceneName) {
+	Common::String fname = sceneName;
+	fname.toLowercase();
+
+	if (_cacheMap.contains(fname) || !findFile(fname.c_str()))
+		return;
+
+	PrefetchJob job;
+	job.fname = fname;
+	job.scene = true;
+
+	Common::StackLock lock(_prefetchMutex);
+	_prefetchQueue.push_back(job);
+}
+
+void ResourceLoader::collectPrefetched() {
+	Common::List<ResourceCache> done;
+	{
+		Common::StackLock lock(_prefetchMutex);
+		if (_prefetchDone.empty())
+			return;
+		done = _prefetchDone;
+		_prefetchDone.clear();
+	}
+
+	for (Common::List<ResourceCache>::const_iterator i = done.begin(); i != done.end(); ++i) {
+		if (_cacheMap.contains(i->fname))
+			delete i->resPtr;
+		else
+			putIntoCache(i->fname, i->resPtr);
+	}
+
+	trimCache();
+}
+
+void ResourceLoader::prefetchTimerHandler(void *refCon) {
+	ResourceLoader *loader = (ResourceLoader *)refCon;
+	loader->prefetchCallback();
+}
+
+Block *ResourceLoader::prefetchFile(const Common::String &fname) const {
+	const FileIndexEntry *f = findFile(fname.c_str());
+	if (!f)
+		return NULL;
+
+	return f->lab->prefetchFileBlock(f->entry);
+}
+
+void ResourceLoader::prefetchCallback() {
+	// Only handle one file per tick so the timer thread stays responsive
+	PrefetchJob job;
+	{
+		Common::StackLock lock(_prefetchMutex);
+		if (_prefetchQueue.empty())
+			return;
+		job = _prefetchQueue.front();
+		_prefetchQueue.pop_front();
+	}
+
+	Block *b = prefetchFile(job.fname);
+	if (!b)
+		return;
+
+	Common::List<PrefetchJob> deps;
+	if (job.scene) {
+		// Pick the colormaps and setup bitmaps out of the set file. Costumes
+		// and everything else are only known once the scripts run.
+		Common::String data(b->data(), b->len());
+		const char *line = data.c_str();
+		while (line && *line) {
+			char key[32], name[256];
+			if (sscanf(line, " %31s %255s", key, name) == 2 &&
+					(strcmp(key, "colormap") == 0 || strcmp(key, "background") == 0 ||
+					 (strcmp(key, "zbuffer") == 0 && strcmp(name, "<none>.lbm") != 0))) {
+				PrefetchJob dep;
+				dep.fname = name;
+				dep.fname.toLowercase();
+				dep.scene = false;
+				deps.push_back(dep);
+			}
+			line = strchr(line, '\n');
+			if (line)
+				line++;
+		}
+	}
+
+	Common::StackLock lock(_prefetchMutex);
+	ResourceCache entry;
+	entry.fname = job.fname;
+	entry.resPtr = b;
+	_prefetchDone.push_back(entry);
+	for (Common::List<PrefetchJob>::const_iterator i = deps.begin(); i != deps.end(); ++i)
+		_prefetchQueue.push_back(*i);
 }
 
 Bitmap *ResourceLoader::loadBitmap(const char *filename) {
@@ -201,7 +401,10 @@ Bitmap *ResourceLoader::loadBitmap(const char *filename) {
 		putIntoCache(fname, b);
 	}
 
+	pinBlock(fname);
 	Bitmap *result = g_grim->registerBitmap(filename, b->data(), b->len());
+	unpinBlock(fname);
+	acquireBlock(fname);
 	_bitmaps.push_back(result);
 
 	return result;
@@ -219,7 +422,10 @@ CMap *ResourceLoader::loadColormap(const char *filename) {
 		putIntoCache(fname, b);
 	}
 
+	pinBlock(fname);
 	CMap *result = new CMap(filename, b->data(), b->len());
+	unpinBlock(fname);
+	acquireBlock(fname);
 	_colormaps.push_back(result);
 
 	return result;
@@ -235,7 +441,9 @@ Costume *ResourceLoader::loadCostume(const char *filename, Costume *prevCost) {
 			error("Could not find costume \"%s\"", filename);
 		putIntoCache(fname, b);
 	}
+	pinBlock(fname);
 	Costume *result = new Costume(filename, b->data(), b->len(), prevCost);
+	unpinBlock(fname);
 
 	return result;
 }
@@ -251,7 +459,10 @@ Font *ResourceLoader::loadFont(const char *filename) {
 		putIntoCache(fname, b);
 	}
 
+	pinBlock(fname);
 	Font *result = new Font(filename, b->data(), b->len());
+	unpinBlock(fname);
+	acquireBlock(fname);
 	_fonts.push_back(result);
 
 	return result;
@@ -268,7 +479,10 @@ KeyframeAnim *ResourceLoader::loadKeyframe(const char *filename) {
 		putIntoCache(fname, b);
 	}
 
+	pinBlock(fname);
 	KeyframeAnim *result = new KeyframeAnim(filename, b->data(), b->len());
+	unpinBlock(fname);
+	acquireBlock(fname);
 	_keyframeAnims.push_back(result);
 
 	return result;
@@ -278,22 +492,27 @@ LipSync *ResourceLoader::loadLipSync(const char *filename) {
 	Common::String fname = filename;
 	fname.toLowercase();
 	LipSync *result;
+	bool cached = true;
 	Block *b = getFileFromCache(fname.c_str());
 	if (!b) {
 		b = getFileBlock(fname.c_str());
 		if (!b)
 			return NULL;
+		cached = false;
 	}
 
 	result = new LipSync(filename, b->data(), b->len());
 
 	// Some lipsync files have no data
 	if (result->isValid()) {
-		putIntoCache(fname, b);
+		if (!cached)
+			putIntoCache(fname, b);
+		acquireBlock(fname);
 		_lipsyncs.push_back(result);
 	} else {
 		delete result;
-		delete b;
+		if (!cached)
+			delete b;
 		result = NULL;
 	}
 
@@ -311,7 +530,10 @@ Material *ResourceLoader::loadMaterial(const char *filename, CMap *c) {
 		putIntoCache(fname, b);
 	}
 
+	pinBlock(fname);
 	Material *result = new Material(fname.c_str(), b->data(), b->len(), c);
+	unpinBlock(fname);
+	acquireBlock(fname);
 	_materials.push_back(result);
 
 	return result;
@@ -328,7 +550,10 @@ Model *ResourceLoader::loadModel(const char *filename, CMap *c) {
 		putIntoCache(fname, b);
 	}
 
+	pinBlock(fname);
 	Model *result = new Model(filename, b->data(), b->len(), c);
+	unpinBlock(fname);
+	acquireBlock(fname);
 	_models.push_back(result);
 
 	return result;
@@ -338,47 +563,41 @@ void ResourceLoader::uncache(const char *filename) {
 	Common::String fname = filename;
 	fname.toLowercase();
 
-	if (_cacheDirty) {
-		qsort(_cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-		_cacheDirty = false;
-	}
-
-	for (unsigned int i = 0; i < _cache.size(); i++) {
-		if (fname.compareTo(_cache[i].fname) == 0) {
-			delete[] _cache[i].fname;
-			_cacheMemorySize -= _cache[i].resPtr->len();
-			delete _cache[i].resPtr;
-			_cache.remove_at(i);
-			_cacheDirty = true;
-		}
-	}
+	removeFromCache(fname);
 }
 
 void ResourceLoader::uncacheMaterial(Material *mat) {
+	releaseBlock(mat->_fname.c_str());
 	_materials.remove(mat);
 }
 
 void ResourceLoader::uncacheBitmap(Bitmap *bitmap) {
+	releaseBlock(bitmap->filename());
 	_bitmaps.remove(bitmap);
 }
 
 void ResourceLoader::uncacheModel(Model *m) {
+	releaseBlock(m->_fname.c_str());
 	_models.remove(m);
 }
 
 void ResourceLoader::uncacheColormap(CMap *c) {
+	releaseBlock(c->_fname.c_str());
 	_colormaps.remove(c);
 }
 
 void ResourceLoader::uncacheKeyframe(KeyframeAnim *k) {
+	releaseBlock(k->filename());
 	_keyframeAnims.remove(k);
 }
 
 void ResourceLoader::uncacheFont(Font *f) {
+	releaseBlock(f->getFilename().c_str());
 	_fonts.remove(f);
 }
 
 void ResourceLoader::uncacheLipSync(LipSync *s) {
+	releaseBlock(s->getFilename());
 	_lipsyncs.remove(s);
 }
 
@@ -27,6 +27,9 @@
 #define GRIM_RESOURCE_H
 
 #include "common/archive.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/mutex.h"
 
 #include "engines/grim/lab.h"
 #include "engines/grim/object.h"
@@ -67,7 +70,10 @@ public:
 	LipSync *loadLipSync(const char *fname);
 	Block *getFileBlock(const char *filename) const;
 	Block *getBlock(const char *filename);
-	Common::File *openNewStreamFile(const char *filename) const;
+	// Keeps a cached block from being evicted while it is being parsed
+	void pinBlock(const Common::String &fname);
+	void unpinBlock(const Common::String &fname);
+	Common::SeekableReadStream *openNewStreamFile(const char *filename) const;
 	LuaFile *openNewStreamLuaFile(const char *filename) const;
 	void uncache(const char *fname);
 	bool fileExists(const char *filename) const;
@@ -89,23 +95,80 @@ public:
 	void uncacheLipSync(LipSync *l);
 
 	struct ResourceCache {
-		char *fname;
+		Common::String fname;
 		Block *resPtr;
+		// Loads still parsing the block, and loaded objects made from it.
+		// The cache only evicts entries where both are 0.
+		int pins;
+		int users;
 	};
 
+	struct CacheStats {
+		uint32 hits;
+		uint32 misses;
+		uint32 evictions;
+		uint32 entries;
+		int32 memorySize;
+		int32 memoryBudget;
+	};
+
+	void getCacheStats(CacheStats &stats) const;
+	void setCacheBudget(int32 bytes);
+
+	void preloadScene(const char *sceneName);
+	// Moves the files read ahead into the cache. Only called from the
+	// main loop, never while a resource is being loaded.
+	void collectPrefetched();
+
 private:
-	const Lab *getLab(const char *filename) const;
+	struct FileIndexEntry {
+		const Lab *lab;
+		Lab::LabEntry entry;
+	};
+
+	void buildFileIndex();
+	const FileIndexEntry *findFile(const char *filename) const;
 	Block *getFileFromCache(const char *filename);
-	ResourceLoader::ResourceCache *getEntryFromCache(const char *filename);
 	void putIntoCache(Common::String fname, Block *res);
+	void removeFromCache(const Common::String &fname);
+	void trimCache();
+	void acquireBlock(const Common::String &fname);
+	void releaseBlock(const char *fname);
+
+	static void prefetchTimerHandler(void *refCon);
+	void prefetchCallback();
+	Block *prefetchFile(const Common::String &fname) const;
 
 	typedef Common::List<Lab *> LabList;
 	LabList _labs;
 	Common::SearchSet _files;
 
-	Common::Array<ResourceCache> _cache;
-	bool _cacheDirty;
+	// Every file of every archive, resolved to the archive that takes
+	// precedence for it
+	typedef Common::HashMap<Common::String, FileIndexEntry, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> FileIndex;
+	FileIndex _fileIndex;
+
+	// Cached blocks, most recently used first. The hash map indexes into
+	// the list so lookups and promotions don't have to walk it.
+	typedef Common::List<ResourceCache> CacheList;
+	typedef Common::HashMap<Common::String, CacheList::iterator, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> CacheMap;
+	CacheList _cache;
+	CacheMap _cacheMap;
 	int32 _cacheMemorySize;
+	int32 _cacheMemoryBudget;
+	uint32 _cacheHits;
+	uint32 _cacheMisses;
+	uint32 _cacheEvictions;
+
+	// Files are read ahead on the timer thread and handed back to the
+	// main thread through _prefetchDone, which moves them into the cache
+	struct PrefetchJob {
+		Common::String fname;
+		bool scene;
+	};
+	Common::Mutex _prefetchMutex;
+	Common::List<PrefetchJob> _prefetchQueue;
+	Common::List<ResourceCache> _prefetchDone;
 
 	Common::List<Material *> _materials;
 	Common::List<Bitmap *> _bitmaps;
@@ -23,8 +23,11 @@
  *
  */
 
+#include "common/config-manager.h"
 #include "common/endian.h"
+#include "common/mutex.h"
 #include "common/system.h"
+#include "common/timer.h"
 
 #include "graphics/vector3d.h"
 
@@ -37,9 +40,91 @@ namespace Grim {
 #define SAVEGAME_FOOTERTAG	'ESAV'
 #define SAVEGAME_VERSION		7
 
+#define SAVEGAME_BUFFER_SIZE	(64 * 1024)
+#define SAVEGAME_WRITE_CHUNK	(32 * 1024)	// bytes written by each timer call
+#define SAVEGAME_WRITE_PERIOD	10000		// in microseconds
+
+// A savegame serialized in memory, written to its file by a timer proc
+// so that the game doesn't stop while the save file compresses it
+struct SaveGameWriter {
+	Common::OutSaveFile *file;
+	byte *data;
+	uint32 size;
+	uint32 capacity;
+	uint32 pos;
+	bool done;
+};
+
+static SaveGameWriter *s_writer = NULL;
+static Common::Mutex *s_writerMutex = NULL;
+
+// The buffer of the last savegame, kept for the next one
+static byte *s_spareBuffer = NULL;
+static uint32 s_spareCapacity = 0;
+
+static void recycleBuffer(byte *buffer, uint32 capacity) {
+	free(s_spareBuffer);
+	s_spareBuffer = buffer;
+	s_spareCapacity = capacity;
+}
+
+static void writeChunk(SaveGameWriter *w, uint32 size) {
+	if (size > w->size - w->pos)
+		size = w->size - w->pos;
+	w->file->write(w->data + w->pos, size);
+	w->pos += size;
+	if (w->pos == w->size) {
+		w->file->finalize();
+		w->done = true;
+	}
+}
+
+static void writeCallback(void *) {
+	Common::StackLock lock(*s_writerMutex);
+	if (s_writer && !s_writer->done)
+		writeChunk(s_writer, SAVEGAME_WRITE_CHUNK);
+}
+
+static void closeWriter() {
+	g_system->getTimerManager()->removeTimerProc(&writeCallback);
+	if (s_writer->file->err())
+		warning("SaveGame::~SaveGame() Can't write file. (Disk full?)");
+	delete s_writer->file;
+	recycleBuffer(s_writer->data, s_writer->capacity);
+	delete s_writer;
+	s_writer = NULL;
+}
+
+// Releases the background write once it is over. Called every frame.
+void SaveGame::pollWrites() {
+	if (!s_writer)
+		return;
+	{
+		Common::StackLock lock(*s_writerMutex);
+		if (!s_writer->done)
+			return;
+	}
+	closeWriter();
+}
+
+// Completes the background write right away, before the savegame is
+// read or another one written
+void SaveGame::finishWrites() {
+	if (!s_writer)
+		return;
+	{
+		Common::StackLock lock(*s_writerMutex);
+		if (!s_writer->done)
+			writeChunk(s_writer, s_writer->size);
+	}
+	closeWriter();
+}
+
 // Constructor. Should create/open a saved game
 SaveGame::SaveGame(const char *filename, bool saving) :
-		_saving(saving), _currentSection(0) {
+		_saving(saving), _async(false), _currentSection(0), _sectionBuffer(NULL),
+		_buffer(NULL), _bufferSize(0), _bufferCapacity(0), _sectionStart(0) {
+	finishWrites();
 	if (_saving) {
 		_outSaveFile = g_system->getSavefileManager()->openForSaving(filename);
 		if (!_outSaveFile) {
@@ -48,6 +133,12 @@ SaveGame::SaveGame(const char *filename, bool saving) :
 		}
 		_outSaveFile->writeUint32BE(SAVEGAME_HEADERTAG);
 		_outSaveFile->writeUint32BE(SAVEGAME_VERSION);
+
+		_async = ConfMan.getBool("savegame_async");
+		_buffer = s_spareBuffer;
+		_bufferCapacity = s_spareCapacity;
+		s_spareBuffer = NULL;
+		s_spareCapacity = 0;
 	} else {
 		uint32 tag, version;
 
@@ -65,23 +156,58 @@ SaveGame::SaveGame(const char *filename, bool saving) :
 
 SaveGame::~SaveGame() {
 	if (_saving) {
+		if (_async && _outSaveFile) {
+			WRITE_BE_UINT32(reserve(4), SAVEGAME_FOOTERTAG);
+
+			if (!s_writerMutex)
+				s_writerMutex = new Common::Mutex();
+			s_writer = new SaveGameWriter;
+			s_writer->file = _outSaveFile;
+			s_writer->data = _buffer;
+			s_writer->size = _bufferSize;
+			s_writer->capacity = _bufferCapacity;
+			s_writer->pos = 0;
+			s_writer->done = false;
+			g_system->getTimerManager()->installTimerProc(&writeCallback, SAVEGAME_WRITE_PERIOD, NULL);
+			return;
+		}
 		_outSaveFile->writeUint32BE(SAVEGAME_FOOTERTAG);
 		_outSaveFile->finalize();
 		if (_outSaveFile->err())
 			warning("SaveGame::~SaveGame() Can't write file. (Disk full?)");
 		delete _outSaveFile;
+		recycleBuffer(_buffer, _bufferCapacity);
 	} else {
 		delete _inSaveFile;
 	}
 }
 
+// Makes room for size more bytes in the save buffer, growing it geometrically
+byte *SaveGame::reserve(uint32 size) {
+	if (_bufferSize + size > _bufferCapacity) {
+		uint32 capacity = _bufferCapacity ? _bufferCapacity : SAVEGAME_BUFFER_SIZE;
+		while (capacity < _bufferSize + size)
+			capacity *= 2;
+		_buffer = (byte *)realloc(_buffer, capacity);
+		if (!_buffer)
+			error("Failed to allocate space for buffer");
+		_bufferCapacity = capacity;
+	}
+	byte *data = _buffer + _bufferSize;
+	_bufferSize += size;
+	return data;
+}
+
 uint32 SaveGame::beginSection(uint32 sectionTag) {
 	if (_currentSection != 0)
 		error("Tried to begin a new save game section with ending old section");
 	_currentSection = sectionTag;
 	_sectionSize = 0;
-	_sectionBuffer = (byte *)malloc(_sectionSize);
-	if (!_saving) {
+	if (_saving) {
+		// the size is filled in by endSection()
+		WRITE_BE_UINT32(reserve(8), sectionTag);
+		_sectionStart = _bufferSize;
+	} else {
 		uint32 tag = 0;
 
 		while (tag != sectionTag) {
@@ -102,18 +228,22 @@ void SaveGame::endSection() {
 	if (_currentSection == 0)
 		error("Tried to end a save game section without starting a section");
 	if (_saving) {
-		_outSaveFile->writeUint32BE(_currentSection);
-		_outSaveFile->writeUint32BE(_sectionSize);
-		_outSaveFile->write(_sectionBuffer, _sectionSize);
+		WRITE_BE_UINT32(_buffer + _sectionStart - 4, _bufferSize - _sectionStart);
+		// Without the background writer, sections go to the file as they end
+		if (!_async) {
+			_outSaveFile->write(_buffer, _bufferSize);
+			_bufferSize = 0;
+		}
+	} else {
+		free(_sectionBuffer);
+		_sectionBuffer = NULL;
 	}
-	free(_sectionBuffer);
-	_sectionBuffer = NULL;
 	_currentSection = 0;
 }
 
 uint32 SaveGame::getBufferPos() {
 	if (_saving)
-		return _sectionSize;
+		return _bufferSize - _sectionStart;
 	else
 		return _sectionPtr;
 }
@@ -172,11 +302,7 @@ void SaveGame::write(const void *data, int size) {
 		error("SaveGame::writeBlock called when restoring a savegame");
 	if (_currentSection == 0)
 		error("Tried to write a block without starting a section");
-	_sectionBuffer = (byte *)realloc(_sectionBuffer, _sectionSize + size);
-	if (!_sectionBuffer)
-		error("Failed to allocate space for buffer");
-	memcpy(&_sectionBuffer[_sectionSize], data, size);
-	_sectionSize += size;
+	memcpy(reserve(size), data, size);
 }
 
 void SaveGame::writeLEUint32(uint32 data) {
@@ -184,12 +310,7 @@ void SaveGame::writeLEUint32(uint32 data) {
 		error("SaveGame::writeBlock called when restoring a savegame");
 	if (_currentSection == 0)
 		error("Tried to write a block without starting a section");
-	_sectionBuffer = (byte *)realloc(_sectionBuffer, _sectionSize + 4);
-	if (!_sectionBuffer)
-		error("Failed to allocate space for buffer");
-
-	WRITE_LE_UINT32(&_sectionBuffer[_sectionSize], data);
-	_sectionSize += 4;
+	WRITE_LE_UINT32(reserve(4), data);
 }
 
 void SaveGame::writeLESint32(int32 data) {
@@ -197,12 +318,7 @@ void SaveGame::writeLESint32(int32 data) {
 		error("SaveGame::writeBlock called when restoring a savegame");
 	if (_currentSection == 0)
 		error("Tried to write a block without starting a section");
-	_sectionBuffer = (byte *)realloc(_sectionBuffer, _sectionSize + 4);
-	if (!_sectionBuffer)
-		error("Failed to allocate space for buffer");
-
-	WRITE_LE_UINT32(&_sectionBuffer[_sectionSize], (uint32)data);
-	_sectionSize += 4;
+	WRITE_LE_UINT32(reserve(4), (uint32)data);
 }
 
 void SaveGame::writeLEBool(bool data) {
@@ -210,12 +326,7 @@ void SaveGame::writeLEBool(bool data) {
 		error("SaveGame::writeBlock called when restoring a savegame");
 	if (_currentSection == 0)
 		error("Tried to write a block without starting a section");
-	_sectionBuffer = (byte *)realloc(_sectionBuffer, _sectionSize + 4);
-	if (!_sectionBuffer)
-		error("Failed to allocate space for buffer");
-
-	WRITE_LE_UINT32(&_sectionBuffer[_sectionSize], (uint32)data);
-	_sectionSize += 4;
+	WRITE_LE_UINT32(reserve(4), (uint32)data);
 }
 
 void SaveGame::writeByte(byte data) {
@@ -223,12 +334,7 @@ void SaveGame::writeByte(byte data) {
 		error("SaveGame::writeBlock called when restoring a savegame");
 	if (_currentSection == 0)
 		error("Tried to write a block without starting a section");
-	_sectionBuffer = (byte *)realloc(_sectionBuffer, _sectionSize + 1);
-	if (!_sectionBuffer)
-		error("Failed to allocate space for buffer");
-
-	_sectionBuffer[_sectionSize] = data;
-	_sectionSize++;
+	*reserve(1) = data;
 }
 
 void SaveGame::writeVector3d(const Graphics::Vector3d &vec) {
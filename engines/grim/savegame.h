@@ -66,14 +66,27 @@ public:
 	const char *readCharString();
 	Common::String readString();
 
+	static void pollWrites();
+	static void finishWrites();
+
 protected:
+	byte *reserve(uint32 size);
+
 	bool _saving;
+	bool _async;
 	Common::InSaveFile *_inSaveFile;
 	Common::OutSaveFile *_outSaveFile;
 	uint32 _currentSection;
 	uint32 _sectionSize;
 	uint32 _sectionPtr;
 	byte *_sectionBuffer;
+
+	// When saving, the sections are serialized in here, the whole
+	// game at once when writing in the background
+	byte *_buffer;
+	uint32 _bufferSize;
+	uint32 _bufferCapacity;
+	uint32 _sectionStart;
 };
 
 } // end of namespace Grim
@@ -110,6 +110,8 @@ Scene::Scene(const char *sceneName, const char *buf, int len) :
         _sectors[i] = new Sector();
 		_sectors[i]->load(ts);
 	}
+	buildSectorGraph();
+	buildSectorGrid();
 }
 
 Scene::Scene() :
@@ -274,6 +276,8 @@ bool Scene::restoreState(SaveGame *savedState) {
 	} else {
 		_sectors = NULL;
 	}
+	buildSectorGraph();
+	buildSectorGrid();
 
 	_numLights = savedState->readLEUint32();
 	_lights = new Light[_numLights];
@@ -424,9 +428,114 @@ void Scene::drawBitmaps(ObjectState::Position stage) {
 	}
 }
 
-Sector *Scene::findPointSector(Graphics::Vector3d p, Sector::SectorType type) {
+// Sector geometry never changes, so the adjacency is worked out once for
+// all the sectors. Users filter the neighbours by type and visibility.
+void Scene::buildSectorGraph() {
+	int numSectors = _numSectors > 0 ? _numSectors : 0;
+
+	_adjacencyStart.clear();
+	_adjacency.clear();
+	_adjacencyStart.push_back(0);
+	for (int i = 0; i < numSectors; i++) {
+		for (int j = 0; j < numSectors; j++) {
+			if (j != i && _sectors[i]->isAdjacentTo(_sectors[j]))
+				_adjacency.push_back(j);
+		}
+		_adjacencyStart.push_back(_adjacency.size());
+	}
+}
+
+int Scene::getSectorIndex(Sector *sector) const {
 	for (int i = 0; i < _numSectors; i++) {
-		Sector *sector = _sectors[i];
+		if (_sectors[i] == sector)
+			return i;
+	}
+	return -1;
+}
+
+void Scene::buildSectorGrid() {
+	int numSectors = _numSectors > 0 ? _numSectors : 0;
+
+	_sectorBounds.resize(numSectors);
+	_gridStart.clear();
+	_gridSectors.clear();
+	_gridW = _gridH = 0;
+	if (numSectors == 0)
+		return;
+
+	float minX = 0, minY = 0, maxX = 0, maxY = 0;
+	for (int i = 0; i < numSectors; i++) {
+		Graphics::Vector3d *vertices = _sectors[i]->getVertices();
+		SectorBounds &b = _sectorBounds[i];
+		b.x1 = b.x2 = vertices[0].x();
+		b.y1 = b.y2 = vertices[0].y();
+		for (int j = 1; j < _sectors[i]->getNumVertices(); j++) {
+			b.x1 = MIN(b.x1, vertices[j].x());
+			b.y1 = MIN(b.y1, vertices[j].y());
+			b.x2 = MAX(b.x2, vertices[j].x());
+			b.y2 = MAX(b.y2, vertices[j].y());
+		}
+		if (i == 0) {
+			minX = b.x1;
+			minY = b.y1;
+			maxX = b.x2;
+			maxY = b.y2;
+		} else {
+			minX = MIN(minX, b.x1);
+			minY = MIN(minY, b.y1);
+			maxX = MAX(maxX, b.x2);
+			maxY = MAX(maxY, b.y2);
+		}
+	}
+
+	// about one sector per cell
+	_gridW = _gridH = CLIP((int)sqrt((float)numSectors), 1, 32);
+	_gridX = minX;
+	_gridY = minY;
+	_gridCellW = MAX((maxX - minX) / _gridW, 0.001f);
+	_gridCellH = MAX((maxY - minY) / _gridH, 0.001f);
+
+	// the bounds are padded so that rounding in gridCell() can't miss a
+	// sector touching the border of a cell
+	float padX = _gridCellW * 0.01f, padY = _gridCellH * 0.01f;
+	_gridStart.push_back(0);
+	for (int cy = 0; cy < _gridH; cy++) {
+		for (int cx = 0; cx < _gridW; cx++) {
+			float x1 = _gridX + cx * _gridCellW, y1 = _gridY + cy * _gridCellH;
+			float x2 = x1 + _gridCellW, y2 = y1 + _gridCellH;
+			for (int i = 0; i < numSectors; i++) {
+				const SectorBounds &b = _sectorBounds[i];
+				if (b.x1 - padX <= x2 && b.x2 + padX >= x1 && b.y1 - padY <= y2 && b.y2 + padY >= y1)
+					_gridSectors.push_back(i);
+			}
+			_gridStart.push_back(_gridSectors.size());
+		}
+	}
+}
+
+// Returns the grid cell holding p, or -1 if p is outside all the sectors.
+int Scene::gridCell(Graphics::Vector3d p) const {
+	if (_gridW == 0)
+		return -1;
+	float fx = (p.x() - _gridX) / _gridCellW;
+	float fy = (p.y() - _gridY) / _gridCellH;
+	// points within the padding of the grid border still go to the border
+	// cells, the edge tests of the sectors decide for them
+	if (fx < -0.01f || fx > _gridW + 0.01f || fy < -0.01f || fy > _gridH + 0.01f)
+		return -1;
+	int cx = CLIP((int)floor(fx), 0, _gridW - 1);
+	int cy = CLIP((int)floor(fy), 0, _gridH - 1);
+	return cy * _gridW + cx;
+}
+
+Sector *Scene::findPointSector(Graphics::Vector3d p, Sector::SectorType type) {
+	// the cell lists are in sector order, so the first match is the same
+	// as with a scan of all the sectors
+	int cell = gridCell(p);
+	if (cell < 0)
+		return NULL;
+	for (int i = _gridStart[cell]; i < _gridStart[cell + 1]; i++) {
+		Sector *sector = _sectors[_gridSectors[i]];
 		if (sector && (sector->type() & type) && sector->visible() && sector->isPointInSector(p))
 			return sector;
 	}
@@ -438,10 +547,38 @@ void Scene::findClosestSector(Graphics::Vector3d p, Sector **sect, Graphics::Vec
 	Graphics::Vector3d resultPt = p;
 	float minDist = 0.0;
 
+	// The sectors near p give an upper bound for the distance. A sector
+	// can't be closer than its xy bounds, so the ones whose bounds are
+	// further than that are skipped without computing their closest point.
+	bool bounded = false;
+	float bound = 0.0;
+	int cell = gridCell(p);
+	if (cell >= 0) {
+		for (int i = _gridStart[cell]; i < _gridStart[cell + 1]; i++) {
+			Sector *sector = _sectors[_gridSectors[i]];
+			if ((sector->type() & Sector::WalkType) == 0 || !sector->visible())
+				continue;
+			float thisDist = (sector->closestPoint(p) - p).magnitude();
+			if (!bounded || thisDist < bound) {
+				bound = thisDist;
+				bounded = true;
+			}
+		}
+		// leave some room for rounding
+		bound = bound * 1.0001f + 0.0001f;
+	}
+
 	for (int i = 0; i < _numSectors; i++) {
 		Sector *sector = _sectors[i];
 		if ((sector->type() & Sector::WalkType) == 0 || !sector->visible())
 			continue;
+		if (bounded) {
+			const SectorBounds &b = _sectorBounds[i];
+			float dx = MAX(MAX(b.x1 - p.x(), p.x() - b.x2), 0.f);
+			float dy = MAX(MAX(b.y1 - p.y(), p.y() - b.y2), 0.f);
+			if (dx > bound || dy > bound || dx * dx + dy * dy > bound * bound)
+				continue;
+		}
 		Graphics::Vector3d closestPt = sector->closestPoint(p);
 		float thisDist = (closestPt - p).magnitude();
 		if (!resultSect || thisDist < minDist) {
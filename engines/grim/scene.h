@@ -26,6 +26,8 @@
 #ifndef GRIM_SCENE_H
 #define GRIM_SCENE_H
 
+#include "common/array.h"
+
 #include "engines/grim/color.h"
 #include "engines/grim/walkplane.h"
 #include "engines/grim/objectstate.h"
@@ -82,6 +84,13 @@ public:
 		else
 			return NULL;
 	}
+	int getSectorIndex(Sector *sector) const;
+	// The sectors sharing an edge with the sector at index id, as indices.
+	// Visibility is not taken into account.
+	const int *getAdjacentSectors(int id, int *count) const {
+		*count = _adjacencyStart[id + 1] - _adjacencyStart[id];
+		return _adjacency.begin() + _adjacencyStart[id];
+	}
 	Sector *findPointSector(Graphics::Vector3d p, Sector::SectorType type);
 	void findClosestSector(Graphics::Vector3d p, Sector **sect, Graphics::Vector3d *closestPt);
 
@@ -119,6 +128,9 @@ public:
 	bool _locked;
 
 private:
+	void buildSectorGraph();
+	void buildSectorGrid();
+	int gridCell(Graphics::Vector3d p) const;
 
 	Common::String _name;
 	int _numCmaps;
@@ -128,6 +140,20 @@ private:
 	Sector **_sectors;
 	Light *_lights;
 	Setup *_setups;
+	// sector adjacency, _adjacency[_adjacencyStart[i].._adjacencyStart[i + 1]]
+	// lists the neighbours of sector i
+	Common::Array<int> _adjacencyStart;
+	Common::Array<int> _adjacency;
+	// xy bounds of each sector, and a uniform grid over them whose cells
+	// list the sectors overlapping them, laid out as the adjacency above
+	struct SectorBounds {
+		float x1, y1, x2, y2;
+	};
+	Common::Array<SectorBounds> _sectorBounds;
+	float _gridX, _gridY, _gridCellW, _gridCellH;
+	int _gridW, _gridH;
+	Common::Array<int> _gridStart;
+	Common::Array<int> _gridSectors;
 public:
 	Setup *_currSetup;
 private:
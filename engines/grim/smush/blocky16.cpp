@@ -23,6 +23,14 @@
  *
  */
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BLOCKY16_SIMD
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BLOCKY16_SIMD
+#endif
+
 #include "common/endian.h"
 #include "common/util.h"
 
@@ -87,6 +95,85 @@ namespace Grim {
 
 #endif
 
+#ifdef BLOCKY16_SIMD
+
+// Copy and fill kernels for the 8x8 and 4x4 blocks, one row per store.
+// The source of a copy always lies in one of the other frame buffers, so
+// rows never overlap and copying 16 bytes at once gives the same result
+// as the 4 byte copies above.
+
+#if defined(__SSE2__)
+
+static inline void copyBlock8x8(byte *dst, const byte *src, int pitch) {
+	for (int i = 0; i < 8; i++) {
+		_mm_storeu_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+		dst += pitch;
+		src += pitch;
+	}
+}
+
+static inline void fillBlock8x8(byte *dst, uint32 t, int pitch) {
+	__m128i v = _mm_set1_epi32(t);
+	for (int i = 0; i < 8; i++) {
+		_mm_storeu_si128((__m128i *)dst, v);
+		dst += pitch;
+	}
+}
+
+static inline void copyBlock4x4(byte *dst, const byte *src, int pitch) {
+	for (int i = 0; i < 4; i++) {
+		_mm_storel_epi64((__m128i *)dst, _mm_loadl_epi64((const __m128i *)src));
+		dst += pitch;
+		src += pitch;
+	}
+}
+
+static inline void fillBlock4x4(byte *dst, uint32 t, int pitch) {
+	__m128i v = _mm_set1_epi32(t);
+	for (int i = 0; i < 4; i++) {
+		_mm_storel_epi64((__m128i *)dst, v);
+		dst += pitch;
+	}
+}
+
+#else
+
+static inline void copyBlock8x8(byte *dst, const byte *src, int pitch) {
+	for (int i = 0; i < 8; i++) {
+		vst1q_u8(dst, vld1q_u8(src));
+		dst += pitch;
+		src += pitch;
+	}
+}
+
+static inline void fillBlock8x8(byte *dst, uint32 t, int pitch) {
+	uint8x16_t v = vreinterpretq_u8_u32(vdupq_n_u32(t));
+	for (int i = 0; i < 8; i++) {
+		vst1q_u8(dst, v);
+		dst += pitch;
+	}
+}
+
+static inline void copyBlock4x4(byte *dst, const byte *src, int pitch) {
+	for (int i = 0; i < 4; i++) {
+		vst1_u8(dst, vld1_u8(src));
+		dst += pitch;
+		src += pitch;
+	}
+}
+
+static inline void fillBlock4x4(byte *dst, uint32 t, int pitch) {
+	uint8x8_t v = vreinterpret_u8_u32(vdup_n_u32(t));
+	for (int i = 0; i < 4; i++) {
+		vst1_u8(dst, v);
+		dst += pitch;
+	}
+}
+
+#endif
+
+#endif
+
 static int8 blocky16_table_small1[] = {
 	0, 1, 2, 3, 3, 3, 3, 2, 1, 0, 0, 0, 1, 2, 2, 1,
 };
@@ -362,7 +449,7 @@ void Blocky16::makeTables47(int width) {
 }
 
 void Blocky16::level3(byte *d_dst) {
-	int32 tmp2;
+	ptrdiff_t tmp2;
 	uint32 t;
 	byte code = *_d_src++;
 	int i;
@@ -429,7 +516,7 @@ void Blocky16::level3(byte *d_dst) {
 }
 
 void Blocky16::level2(byte *d_dst) {
-	int32 tmp2;
+	ptrdiff_t tmp2;
 	uint32 t = 0, val;
 	byte code = *_d_src++;
 	int i;
@@ -443,6 +530,12 @@ void Blocky16::level2(byte *d_dst) {
 			tmp2 = _table[code] * 2;
 		}
 		tmp2 += _offset1;
+#ifdef BLOCKY16_SIMD
+		if (_simdBlocks) {
+			copyBlock4x4(d_dst, d_dst + tmp2, _d_pitch);
+			return;
+		}
+#endif
 		for (i = 0; i < 4; i++) {
 			COPY_4X1_LINE(d_dst +  0, d_dst + tmp2 +  0);
 			COPY_4X1_LINE(d_dst +  4, d_dst + tmp2 +  4);
@@ -458,6 +551,12 @@ void Blocky16::level2(byte *d_dst) {
 		level3(d_dst);
 	} else if (code == 0xF6) {
 		tmp2 = _offset2;
+#ifdef BLOCKY16_SIMD
+		if (_simdBlocks) {
+			copyBlock4x4(d_dst, d_dst + tmp2, _d_pitch);
+			return;
+		}
+#endif
 		for (i = 0; i < 4; i++) {
 			COPY_4X1_LINE(d_dst +  0, d_dst + tmp2 +  0);
 			COPY_4X1_LINE(d_dst +  4, d_dst + tmp2 +  4);
@@ -501,6 +600,12 @@ void Blocky16::level2(byte *d_dst) {
 			t = READ_LE_UINT16(_paramPtr + code * 2);
 			t = (t << 16) | t;
 		}
+#ifdef BLOCKY16_SIMD
+		if (_simdBlocks) {
+			fillBlock4x4(d_dst, t, _d_pitch);
+			return;
+		}
+#endif
 		for (i = 0; i < 4; i++) {
 			WRITE_4X1_LINE(d_dst + 0, t);
 			WRITE_4X1_LINE(d_dst + 4, t);
@@ -510,7 +615,7 @@ void Blocky16::level2(byte *d_dst) {
 }
 
 void Blocky16::level1(byte *d_dst) {
-	int32 tmp2;
+	ptrdiff_t tmp2;
 	uint32 t = 0, val;
 	byte code = *_d_src++;
 	int i;
@@ -524,6 +629,12 @@ void Blocky16::level1(byte *d_dst) {
 			tmp2 = _table[code] * 2;
 		}
 		tmp2 += _offset1;
+#ifdef BLOCKY16_SIMD
+		if (_simdBlocks) {
+			copyBlock8x8(d_dst, d_dst + tmp2, _d_pitch);
+			return;
+		}
+#endif
 		for (i = 0; i < 8; i++) {
 			COPY_4X1_LINE(d_dst +  0, d_dst + tmp2 +  0);
 			COPY_4X1_LINE(d_dst +  4, d_dst + tmp2 +  4);
@@ -541,6 +652,12 @@ void Blocky16::level1(byte *d_dst) {
 		level2(d_dst);
 	} else if (code == 0xF6) {
 		tmp2 = _offset2;
+#ifdef BLOCKY16_SIMD
+		if (_simdBlocks) {
+			copyBlock8x8(d_dst, d_dst + tmp2, _d_pitch);
+			return;
+		}
+#endif
 		for (i = 0; i < 8; i++) {
 			COPY_4X1_LINE(d_dst +  0, d_dst + tmp2 +  0);
 			COPY_4X1_LINE(d_dst +  4, d_dst + tmp2 +  4);
@@ -586,6 +703,12 @@ void Blocky16::level1(byte *d_dst) {
 			t = READ_LE_UINT16(_paramPtr + code * 2);
 			t = (t << 16) | t;
 		}
+#ifdef BLOCKY16_SIMD
+		if (_simdBlocks) {
+			fillBlock8x8(d_dst, t, _d_pitch);
+			return;
+		}
+#endif
 		for (i = 0; i < 8; i++) {
 			WRITE_4X1_LINE(d_dst +  0, t);
 			WRITE_4X1_LINE(d_dst +  4, t);
@@ -623,16 +746,25 @@ void Blocky16::init(int width, int height) {
 	makeTablesInterpolation(8);
 
 	_frameSize = _width * _height * 2;
-	// workaround for read over buffer by increasing buffer
-	// 200 bytes is enough for smush anims:
-	// lol, byeruba, crushed, eldepot, heltrain, hostage
-	// but for tb_kitty.snm 5700 bytes is needed
-	_deltaSize = _frameSize * 3 + 5700;
-	_deltaBuf = new byte[_deltaSize];
-	memset(_deltaBuf, 0, _deltaSize);
-	_deltaBufs[0] = _deltaBuf;
-	_deltaBufs[1] = _deltaBuf + _frameSize;
-	_curBuf = _deltaBuf + _frameSize * 2;
+	_deltaBufs[0] = newFrameBuffer();
+	_deltaBufs[1] = newFrameBuffer();
+	_curBuf = newFrameBuffer();
+}
+
+// The motion vectors are 16 bit pixel offsets and may point outside the
+// picture, as may the last row of blocks when the height isn't a multiple
+// of 8, so every buffer the decoder works in has a guard zone on both sides.
+#define BLOCKY16_GUARD 0x10000
+
+byte *Blocky16::newFrameBuffer() {
+	byte *buf = new byte[_frameSize + BLOCKY16_GUARD * 2];
+	memset(buf, 0, _frameSize + BLOCKY16_GUARD * 2);
+	return buf + BLOCKY16_GUARD;
+}
+
+void Blocky16::deleteFrameBuffer(byte *buf) {
+	if (buf)
+		delete[] (buf - BLOCKY16_GUARD);
 }
 
 Blocky16::Blocky16() {
@@ -640,18 +772,24 @@ Blocky16::Blocky16() {
 	_tableSmall = new byte[32768];
 	memset(_tableBig, 0, 99328);
 	memset(_tableSmall, 0, 32768);
-	_deltaBuf = NULL;
+	_deltaBufs[0] = NULL;
+	_deltaBufs[1] = NULL;
+	_curBuf = NULL;
+#ifdef BLOCKY16_SIMD
+	_simdBlocks = true;
+#else
+	_simdBlocks = false;
+#endif
 }
 
 void Blocky16::deinit() {
 	_lastTableWidth = -1;
-	if (_deltaBuf) {
-		delete[] _deltaBuf;
-		_deltaSize = 0;
-		_deltaBuf = NULL;
-		_deltaBufs[0] = NULL;
-		_deltaBufs[1] = NULL;
-	}
+	deleteFrameBuffer(_deltaBufs[0]);
+	deleteFrameBuffer(_deltaBufs[1]);
+	deleteFrameBuffer(_curBuf);
+	_deltaBufs[0] = NULL;
+	_deltaBufs[1] = NULL;
+	_curBuf = NULL;
 }
 
 Blocky16::~Blocky16() {
@@ -729,9 +867,13 @@ static void bompDecodeMain(byte *dst, const byte *src, int size) {
 	}
 }
 
-void Blocky16::decode(byte *dst, const byte *src) {
-	_offset1 = ((_deltaBufs[1] - _curBuf) / 2) * 2;
-	_offset2 = ((_deltaBufs[0] - _curBuf) / 2) * 2;
+// Decodes a frame and returns the buffer holding it, which then belongs to
+// the caller. buf must come from newFrameBuffer(); the decoder may keep it as
+// its work buffer in exchange for the one returned. Returns NULL, keeping buf,
+// if the frame can't be decoded.
+byte *Blocky16::decode(byte *buf, const byte *src) {
+	_offset1 = _deltaBufs[1] - _curBuf;
+	_offset2 = _deltaBufs[0] - _curBuf;
 
 	int32 seq_nb = READ_LE_UINT16(src + 16);
 
@@ -770,10 +912,12 @@ void Blocky16::decode(byte *dst, const byte *src) {
 		error("blocky16: not implemented decode1 proc");
 		break;
 	case 2:
-		if (seq_nb == _prevSeqNb + 1) {
-			decode2(_curBuf, gfx_data, _width, _height, src + 24, src + 40);
+		if (seq_nb != _prevSeqNb + 1) {
+			// a frame is missing, so there is nothing to apply the delta to
+			_prevSeqNb = seq_nb;
+			return NULL;
 		}
-
+		decode2(_curBuf, gfx_data, _width, _height, src + 24, src + 40);
 		break;
 	case 3:
 		memcpy(_curBuf, _deltaBufs[1], _frameSize);
@@ -810,22 +954,29 @@ void Blocky16::decode(byte *dst, const byte *src) {
 		}
 	}
 
-	memcpy(dst, _curBuf, _frameSize);
+	if (seq_nb != _prevSeqNb + 1 || (src[19] != 1 && src[19] != 2)) {
+		// the frame isn't needed to decode the next ones: hand it over
+		byte *frame = _curBuf;
+		_curBuf = buf;
+		_prevSeqNb = seq_nb;
+		return frame;
+	}
 
-	if (seq_nb == _prevSeqNb + 1) {
-		byte *tmp_ptr = NULL;
-		if (src[19] == 1) {
-			tmp_ptr = _curBuf;
-			_curBuf = _deltaBufs[1];
-			_deltaBufs[1] = tmp_ptr;
-		} else if (src[19] == 2) {
-			tmp_ptr = _deltaBufs[0];
-			_deltaBufs[0] = _deltaBufs[1];
-			_deltaBufs[1] = _curBuf;
-			_curBuf = tmp_ptr;
-		}
+	// the frame becomes a delta buffer, so the caller gets a copy
+	memcpy(buf, _curBuf, _frameSize);
+	byte *tmp_ptr = NULL;
+	if (src[19] == 1) {
+		tmp_ptr = _curBuf;
+		_curBuf = _deltaBufs[1];
+		_deltaBufs[1] = tmp_ptr;
+	} else {
+		tmp_ptr = _deltaBufs[0];
+		_deltaBufs[0] = _deltaBufs[1];
+		_deltaBufs[1] = _curBuf;
+		_curBuf = tmp_ptr;
 	}
 	_prevSeqNb = seq_nb;
+	return buf;
 }
 
 } // end of namespace Grim
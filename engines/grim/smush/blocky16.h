@@ -26,6 +26,8 @@
 #ifndef GRIM_BLOCKY16_H
 #define GRIM_BLOCKY16_H
 
+#include <stddef.h>
+
 #include "common/scummsys.h"
 
 namespace Grim {
@@ -33,20 +35,20 @@ namespace Grim {
 class Blocky16 {
 private:
 
-	int32 _deltaSize;
 	byte *_deltaBufs[2];
-	byte *_deltaBuf;
 	byte *_curBuf;
 	int32 _prevSeqNb;
 	int _lastTableWidth;
 	const byte *_d_src, *_paramPtr, *_param6_7Ptr;
 	int _d_pitch;
-	int32 _offset1, _offset2;
+	ptrdiff_t _offset1, _offset2;
 	byte *_tableBig;
 	byte *_tableSmall;
 	int16 _table[256];
 	int32 _frameSize;
 	int _width, _height;
+	// Use the SIMD block kernels, when they are built in
+	bool _simdBlocks;
 
 	void makeTablesInterpolation(int param);
 	void makeTables47(int width);
@@ -60,7 +62,9 @@ public:
 	~Blocky16();
 	void init(int width, int height);
 	void deinit();
-	void decode(byte *dst, const byte *src);
+	byte *decode(byte *buf, const byte *src);
+	byte *newFrameBuffer();
+	static void deleteFrameBuffer(byte *buf);
 };
 
 } // end of namespace Grim
@@ -44,21 +44,41 @@ namespace Grim {
 #define ANNO_HEADER "MakeAnim animation type 'Bl16' parameters: "
 #define BUFFER_SIZE 16385
 
+// Minimum distance between two checkpoints of the frame index. Each one holds
+// a copy of the inflate state, so this trades memory for the number of frames
+// decoded when seeking.
+#define SMUSH_CHECKPOINT_INTERVAL 64
+// How far into a frame to look for its Bl16 chunk when indexing
+#define SMUSH_PEEK_LIMIT 0x10000
+
 Smush *g_smush;
 static uint16 smushDestTable[5786];
 
 void Smush::timerCallback(void *) {
+	Common::StackLock lock(g_smush->_mutex);
+
 	if (g_grim->getGameFlags() & GF_DEMO)
 		g_smush->handleFrameDemo();
 	else
 		g_smush->handleFrame();
 }
 
+// Fills the decode-ahead ring, one frame per call so the other timer
+// procs are not held up; it runs faster than the movie to get ahead.
+void Smush::decodeCallback(void *) {
+	Common::StackLock lock(g_smush->_mutex);
+
+	if (!g_smush->_videoPause && !g_smush->_videoFinished)
+		g_smush->decodeNextFrame();
+}
+
 Smush::Smush() {
 	g_smush = this;
 	_nbframes = 0;
 	_internalBuffer = NULL;
 	_externalBuffer = NULL;
+	_frontBuffer = NULL;
+	_spareBuffer = NULL;
 	_width = 0;
 	_height = 0;
 	_speed = 0;
@@ -68,7 +88,16 @@ Smush::Smush() {
 	_videoLooping = false;
 	_videoPause = true;
 	_updateNeeded = false;
-	_startPos = NULL;
+	_indexedFrames = 0;
+	_ringHead = 0;
+	_ringCount = 0;
+	_decodeFrame = 0;
+	_decodeDone = false;
+	_decodeCount = 0;
+	_startTime = 0;
+	_pauseTime = 0;
+	for (int i = 0; i < SMUSH_RING_SIZE; i++)
+		_ring[i].buffer = NULL;
 	_stream = NULL;
 	_movieTime = 0;
 	_frame = 0;
@@ -77,6 +106,7 @@ Smush::Smush() {
 
 Smush::~Smush() {
 	deinit();
+	clearIndex();
 }
 
 void Smush::init() {
@@ -87,39 +117,53 @@ void Smush::init() {
 	_videoFinished = false;
 	_videoPause = false;
 	_updateNeeded = false;
+	_ringHead = 0;
+	_ringCount = 0;
+	_decodeFrame = 0;
+	_decodeDone = false;
+	_decodeCount = 0;
+	_startTime = g_system->getMillis();
 
 	assert(!_internalBuffer);
 	assert(!_externalBuffer);
 
 	if (!(g_grim->getGameFlags() & GF_DEMO)) {
-		_internalBuffer = new byte[_width * _height * 2];
-		_externalBuffer = new byte[_width * _height * 2];
+		// Blocky16 decodes straight into these buffers, which are then
+		// swapped with the one on screen when presented
+		_externalBuffer = _blocky16.newFrameBuffer();
+		_spareBuffer = _blocky16.newFrameBuffer();
+		for (int i = 0; i < SMUSH_RING_SIZE; i++)
+			_ring[i].buffer = _blocky16.newFrameBuffer();
 		vimaInit(smushDestTable);
+		g_system->getTimerManager()->installTimerProc(&decodeCallback, _speed / 2, NULL);
 	}
+	_frontBuffer = _externalBuffer;
 	g_system->getTimerManager()->installTimerProc(&timerCallback, _speed, NULL);
 }
 
 void Smush::deinit() {
 	g_system->getTimerManager()->removeTimerProc(&timerCallback);
+	g_system->getTimerManager()->removeTimerProc(&decodeCallback);
 
-	if (_internalBuffer) {
+	if (g_grim->getGameFlags() & GF_DEMO) {
 		delete[] _internalBuffer;
-		_internalBuffer = NULL;
-	}
-	if (_externalBuffer) {
 		delete[] _externalBuffer;
-		_externalBuffer = NULL;
-	}
-	if (_videoLooping && _startPos) {
-		delete[] _startPos->tmpBuf;
-		delete[] _startPos;
-		_startPos = NULL;
-	}
-	if (_stream) {
-		_stream->finish();
-		_stream = NULL;
-		g_system->getMixer()->stopHandle(_soundHandle);
+	} else {
+		if (_frontBuffer != _externalBuffer)
+			Blocky16::deleteFrameBuffer(_frontBuffer);
+		Blocky16::deleteFrameBuffer(_externalBuffer);
+		Blocky16::deleteFrameBuffer(_spareBuffer);
+		for (int i = 0; i < SMUSH_RING_SIZE; i++) {
+			Blocky16::deleteFrameBuffer(_ring[i].buffer);
+			_ring[i].buffer = NULL;
+		}
 	}
+	_internalBuffer = NULL;
+	_externalBuffer = NULL;
+	_frontBuffer = NULL;
+	_spareBuffer = NULL;
+	_ringCount = 0;
+	stopAudio();
 	_videoLooping = false;
 	_videoFinished = true;
 	_videoPause = true;
@@ -129,6 +173,14 @@ void Smush::deinit() {
 		_file.close();
 }
 
+void Smush::stopAudio() {
+	if (_stream) {
+		_stream->finish();
+		_stream = NULL;
+		g_system->getMixer()->stopHandle(_soundHandle);
+	}
+}
+
 void Smush::handleWave(const byte *src, uint32 size) {
 	int16 *dst = new int16[size * _channels];
 	decompressVima(src, dst, size * _channels * 2, smushDestTable);
@@ -148,27 +200,8 @@ void Smush::handleWave(const byte *src, uint32 size) {
 	}
 }
 
-void Smush::handleFrame() {
+byte *Smush::readFrame(int32 &size) {
 	uint32 tag;
-	int32 size;
-	int pos = 0;
-
-	if (_videoPause)
-		return;
-
-	if (_videoFinished) {
-		_videoPause = true;
-		return;
-	}
-
-	if (_frame == _nbframes) {
-		// If the video has been looping and was previously on the last
-		// frame then reset the frame number and the movie time, this
-		// needs to occur at the beginning so the last frame has time to
-		// render appropriately
-		_frame = 1;
-		_movieTime = 0;
-	}
 
 	tag = _file.readUint32BE();
 	if (tag == MKTAG('A','N','N','O')) {
@@ -207,37 +240,305 @@ void Smush::handleFrame() {
 	size = _file.readUint32BE();
 	byte *frame = new byte[size];
 	_file.read(frame, size);
+	return frame;
+}
+
+// Returns whether the frame held a picture. buf is then replaced with the
+// buffer holding it, see Blocky16::decode().
+bool Smush::decodeFrame(const byte *frame, int32 size, byte *&buf, bool audio) {
+	bool video = false;
+	int pos = 0;
 
 	do {
 		if (READ_BE_UINT32(frame + pos) == MKTAG('B','l','1','6')) {
-			_blocky16.decode(_internalBuffer, frame + pos + 8);
+			byte *decoded = _blocky16.decode(buf, frame + pos + 8);
+			if (decoded) {
+				buf = decoded;
+				video = true;
+			}
 			pos += READ_BE_UINT32(frame + pos + 4) + 8;
 		} else if (READ_BE_UINT32(frame + pos) == MKTAG('W','a','v','e')) {
-			int decompressed_size = READ_BE_UINT32(frame + pos + 8);
-			if (decompressed_size < 0)
-				handleWave(frame + pos + 8 + 4 + 8, READ_BE_UINT32(frame + pos + 8 + 8));
-			else
-				handleWave(frame + pos + 8 + 4, decompressed_size);
+			if (audio) {
+				int decompressed_size = READ_BE_UINT32(frame + pos + 8);
+				if (decompressed_size < 0)
+					handleWave(frame + pos + 8 + 4 + 8, READ_BE_UINT32(frame + pos + 8 + 8));
+				else
+					handleWave(frame + pos + 8 + 4, decompressed_size);
+			}
 			pos += READ_BE_UINT32(frame + pos + 4) + 8;
 		} else if (gDebugLevel == DEBUG_SMUSH || gDebugLevel == DEBUG_ERROR || gDebugLevel == DEBUG_ALL) {
 			error("Smush::handleFrame() unknown tag");
 		}
 	} while (pos < size);
-	delete[] frame;
+	return video;
+}
+
+void Smush::handleFrame() {
+	if (_videoPause)
+		return;
+
+	if (_videoFinished) {
+		_videoPause = true;
+		return;
+	}
+
+	// the decoder fell behind: decode the frame now rather than skip a tick
+	if (_ringCount == 0 && !decodeNextFrame())
+		return;
+
+	// Show the newest frame which is due, dropping those before it if
+	// the timer fell behind. Half a frame of slack absorbs timer jitter.
+	int32 now = (int32)(g_system->getMillis() - _startTime) + _speed / 2000;
+	if (_ring[_ringHead].showTime > now)
+		return;
+	while (_ringCount > 1) {
+		SmushFrame &next = _ring[(_ringHead + 1) % SMUSH_RING_SIZE];
+		if (next.showTime > now)
+			break;
+		SmushFrame &dropped = _ring[_ringHead];
+		if (dropped.video && !next.video) {
+			// the next frame repeats this picture, so it takes it over
+			byte *buf = next.buffer;
+			next.buffer = dropped.buffer;
+			dropped.buffer = buf;
+			next.video = true;
+		}
+		_ringHead = (_ringHead + 1) % SMUSH_RING_SIZE;
+		_ringCount--;
+	}
+
+	SmushFrame &slot = _ring[_ringHead];
+	if (slot.video)
+		presentBuffer(slot.buffer);
+	_ringHead = (_ringHead + 1) % SMUSH_RING_SIZE;
+	_ringCount--;
+
+	_frame = slot.frame + 1;
+	_movieTime = slot.movieTime;
+	if (_decodeDone && _ringCount == 0) {
+		_videoFinished = true;
+		g_grim->setMode(ENGINE_MODE_NORMAL);
+	}
+}
 
-	memcpy(_externalBuffer, _internalBuffer, _width * _height * 2);
+// Puts buf on screen, and gives back a free buffer in exchange. The buffer
+// last taken by the renderer stays out of the ring until it takes another.
+void Smush::presentBuffer(byte *&buf) {
+	Common::StackLock lock(_frameMutex);
+
+	byte *shown = _externalBuffer;
+	_externalBuffer = buf;
+	if (shown == _frontBuffer) {
+		buf = _spareBuffer;
+		_spareBuffer = NULL;
+	} else {
+		buf = shown;
+	}
 	_updateNeeded = true;
+}
 
-	_frame++;
-	_movieTime += _speed / 1000;
-	if (_frame == _nbframes) {
-		// If we're not supposed to loop (or looping fails) then end the video
-		if (!_videoLooping || !_file.setPos(_startPos)) {
-			_videoFinished = true;
-			g_grim->setMode(ENGINE_MODE_NORMAL);
-			return;
+// Hands the newest frame to the renderer, which may keep using it until the
+// next call.
+byte *Smush::takeFrame() {
+	Common::StackLock lock(_frameMutex);
+
+	if (_frontBuffer != _externalBuffer) {
+		_spareBuffer = _frontBuffer;
+		_frontBuffer = _externalBuffer;
+	}
+	_updateNeeded = false;
+	return _frontBuffer;
+}
+
+void Smush::pause(bool p) {
+	Common::StackLock lock(_mutex);
+
+	if (p == _videoPause)
+		return;
+	// the playback clock stands still while paused
+	if (p)
+		_pauseTime = g_system->getMillis();
+	else
+		_startTime += g_system->getMillis() - _pauseTime;
+	_videoPause = p;
+}
+
+// Decodes the next frame of the movie into a free slot of the ring.
+bool Smush::decodeNextFrame() {
+	int32 size;
+
+	if (_decodeDone || _ringCount == SMUSH_RING_SIZE)
+		return false;
+
+	int tail = (_ringHead + _ringCount) % SMUSH_RING_SIZE;
+	SmushFrame &slot = _ring[tail];
+	struct SavePos *pos = checkpointDue(_decodeFrame) ? _file.getPos() : NULL;
+	byte *frame = readFrame(size);
+	indexFrame(_decodeFrame, pos);
+	slot.video = decodeFrame(frame, size, slot.buffer, true);
+	delete[] frame;
+
+	_decodeCount++;
+	slot.frame = _decodeFrame;
+	slot.movieTime = (_decodeFrame + 1) * (_speed / 1000);
+	slot.showTime = (int32)((int64)_decodeCount * _speed / 1000);
+	_ringCount++;
+	advanceDecoder();
+	return true;
+}
+
+void Smush::advanceDecoder() {
+	_decodeFrame++;
+	if (_decodeFrame == _nbframes) {
+		// If we're not supposed to loop (or looping fails) then the video
+		// ends with this frame
+		if (_videoLooping && seekToCheckpoint(0) == 0)
+			_decodeFrame = 0;
+		else
+			_decodeDone = true;
+	}
+}
+
+// Whether the next frame is a Blocky16 keyframe, found without reading it
+bool Smush::peekKeyframe() {
+	const byte *data = _file.peek(8);
+	if (!data || READ_BE_UINT32(data) != MKTAG('F','R','M','E'))
+		return false;
+
+	int32 size = READ_BE_UINT32(data + 4);
+	int32 pos = 0;
+	while (pos + 8 + 18 <= size && pos < SMUSH_PEEK_LIMIT) {
+		data = _file.peek(8 + pos + 8 + 18);
+		if (!data)
+			return false;
+		const byte *chunk = data + 8 + pos;
+		// a zero sequence number resets the Blocky16 delta buffers
+		if (READ_BE_UINT32(chunk) == MKTAG('B','l','1','6'))
+			return READ_LE_UINT16(chunk + 8 + 16) == 0;
+		pos += READ_BE_UINT32(chunk + 4) + 8;
+	}
+	return false;
+}
+
+// Whether the frame about to be read should become a checkpoint, in which
+// case the position before it is taken. Only the first frame and keyframes
+// can be, since the other frames need the ones before them to be decoded.
+bool Smush::checkpointDue(int32 frame) {
+	if (frame != _indexedFrames)
+		return false;
+	if (_checkpoints.empty())
+		return true;
+	return frame - _checkpoints.back().frame >= SMUSH_CHECKPOINT_INTERVAL && peekKeyframe();
+}
+
+// Called for every frame read in order; the frames past the indexed ones
+// extend the index, and pos becomes a checkpoint if checkpointDue() took one.
+void Smush::indexFrame(int32 frame, struct SavePos *pos) {
+	if (frame != _indexedFrames) {
+		zlibFile::deletePos(pos);
+		return;
+	}
+	_indexedFrames++;
+	if (pos) {
+		SmushCheckpoint checkpoint;
+		checkpoint.frame = frame;
+		checkpoint.pos = pos;
+		_checkpoints.push_back(checkpoint);
+	}
+}
+
+// Moves the file to the last checkpoint at or before frame, indexing the
+// movie up to frame first if needed. Returns the frame of that checkpoint,
+// or -1 on failure.
+int32 Smush::seekToCheckpoint(int32 frame) {
+	if (_checkpoints.empty() || frame >= _nbframes)
+		return -1;
+
+	if (frame >= _indexedFrames) {
+		// skim the frames past the index without decoding them
+		int32 f = _checkpoints.back().frame;
+		if (!_file.setPos(_checkpoints.back().pos))
+			return -1;
+		for (; f <= frame; f++) {
+			int32 size;
+			struct SavePos *pos = checkpointDue(f) ? _file.getPos() : NULL;
+			byte *data = readFrame(size);
+			indexFrame(f, pos);
+			delete[] data;
 		}
 	}
+
+	int lo = 0, hi = _checkpoints.size() - 1;
+	if (_checkpoints[lo].frame > frame)
+		return -1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (_checkpoints[mid].frame <= frame)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	if (!_file.setPos(_checkpoints[lo].pos))
+		return -1;
+	return _checkpoints[lo].frame;
+}
+
+void Smush::clearIndex() {
+	for (uint i = 0; i < _checkpoints.size(); i++)
+		zlibFile::deletePos(_checkpoints[i].pos);
+	_checkpoints.clear();
+	_indexedFrames = 0;
+}
+
+// Shows frame, decoding the video from the closest checkpoint before it.
+// Playback then continues with the frame after it. Checkpoints are only made
+// at keyframes, so the cost is bounded by their spacing; most movies only
+// have one at the start, and seeking far into them decodes everything up to
+// the frame.
+bool Smush::seek(int32 frame) {
+	int32 size;
+
+	if (g_grim->getGameFlags() & GF_DEMO)
+		return false;
+	if (frame < 0 || frame >= _nbframes)
+		return false;
+
+	Common::StackLock lock(_mutex);
+
+	int32 f = seekToCheckpoint(frame);
+	if (f < 0)
+		return false;
+
+	// the frames decoded ahead belong to the old position, and so does the
+	// sound they queued
+	_ringCount = 0;
+	stopAudio();
+
+	bool video = false;
+	for (; f <= frame; f++) {
+		byte *data = readFrame(size);
+		if (decodeFrame(data, size, _ring[0].buffer, false))
+			video = true;
+		delete[] data;
+	}
+	if (video)
+		presentBuffer(_ring[0].buffer);
+
+	_decodeDone = false;
+	_decodeFrame = frame;
+	advanceDecoder();
+
+	_frame = frame + 1;
+	_movieTime = _frame * (_speed / 1000);
+	_decodeCount = _frame;
+	_startTime = g_system->getMillis() - (int32)((int64)_decodeCount * _speed / 1000);
+	_pauseTime = g_system->getMillis();
+	if (_decodeDone) {
+		_videoFinished = true;
+		g_grim->setMode(ENGINE_MODE_NORMAL);
+	}
+	return true;
 }
 
 static byte delta_color(byte org_color, int16 delta_color) {
@@ -351,12 +652,14 @@ void Smush::handleFrameDemo() {
 			int width = READ_LE_UINT16(frame + pos + 14);
 			int height = READ_LE_UINT16(frame + pos + 16);
 			if (width != _width || height != _height) {
+				Common::StackLock lock(_frameMutex);
 				delete[] _internalBuffer;
 				delete[] _externalBuffer;
 				_width = width;
 				_height = height;
 				_internalBuffer = new byte[_width * _height];
 				_externalBuffer = new byte[_width * _height * 2];
+				_frontBuffer = _externalBuffer;
 				_blocky8.init(_width, _height);
 			}
 			_blocky8.decode(_internalBuffer, frame + pos + 8 + 14);
@@ -451,7 +754,6 @@ bool Smush::setupAnimDemo(const char *file) {
 	_width = -1;
 	_height = -1;
 	_videoLooping = false;
-	_startPos = NULL;
 	_speed = 66667;
 
 	return true;
@@ -505,7 +807,6 @@ bool Smush::setupAnim(const char *file, bool looping, int x, int y) {
 		_speed = 66667;
 	}
 	_videoLooping = looping;
-	_startPos = NULL; // Set later
 	delete[] s_header;
 
 	return true;
@@ -518,6 +819,9 @@ void Smush::stop() {
 
 bool Smush::play(const char *filename, bool looping, int x, int y) {
 	deinit();
+	// the frame index stays valid as long as the same movie is replayed
+	if (_fname != filename)
+		clearIndex();
 	_fname = filename;
 
 	if (gDebugLevel == DEBUG_SMUSH)
@@ -534,9 +838,6 @@ bool Smush::play(const char *filename, bool looping, int x, int y) {
 		handleFramesHeader();
 	}
 
-	if (_videoLooping)
-		_startPos = _file.getPos();
-
 	init();
 
 	return true;
@@ -573,6 +874,10 @@ void Smush::restoreState(SaveGame *state) {
 
 	if (!videoFinished) {
 		play(_fname.c_str(), videoLooping, x, y);
+		// show the frame that was on screen when saving, playback then
+		// resumes right after it
+		if (frame > 0)
+			seek(frame - 1);
 	}
 	_frame = frame;
 	_movieTime = movieTime;
@@ -583,6 +888,10 @@ void Smush::restoreState(SaveGame *state) {
 zlibFile::zlibFile() {
 	_handle = NULL;
 	_inBuf = NULL;
+	_peekBuf = NULL;
+	_peekSize = 0;
+	_peekPos = 0;
+	_peekLen = 0;
 }
 
 zlibFile::~zlibFile() {
@@ -603,15 +912,31 @@ struct SavePos *zlibFile::getPos() {
 	inflateCopy(&pos->streamBuf, &_stream);
 	pos->tmpBuf = new byte[BUFFER_SIZE];
 	memcpy(pos->tmpBuf, _inBuf, BUFFER_SIZE);
+	pos->inOffset = _stream.next_in ? _stream.next_in - _inBuf : 0;
+	pos->peekLen = _peekLen - _peekPos;
+	pos->peekBuf = NULL;
+	if (pos->peekLen) {
+		pos->peekBuf = new byte[pos->peekLen];
+		memcpy(pos->peekBuf, _peekBuf + _peekPos, pos->peekLen);
+	}
 	return pos;
 }
 
+void zlibFile::deletePos(struct SavePos *pos) {
+	if (!pos)
+		return;
+	inflateEnd(&pos->streamBuf);
+	delete[] pos->tmpBuf;
+	delete[] pos->peekBuf;
+	delete pos;
+}
+
 bool zlibFile::setPos(struct SavePos *pos) {
 	if (!pos) {
 		warning("Unable to rewind SMUSH movie (no position passed)");
 		return false;
 	}
-	if (!_handle || !_handle->isOpen()) {
+	if (!_handle) {
 		warning("Unable to rewind SMUSH movie (invalid handle)");
 		return false;
 	}
@@ -621,11 +946,25 @@ bool zlibFile::setPos(struct SavePos *pos) {
 		return false;
 	}
 	memcpy(_inBuf, pos->tmpBuf, BUFFER_SIZE);
+	inflateEnd(&_stream);
 	if (inflateCopy(&_stream, &pos->streamBuf) != Z_OK) {
 		warning("Unable to rewind SMUSH movie (z-lib copy handle failed)");
 		return false;
 	}
+	// the position may come from an earlier opening of the file, whose
+	// input buffer was a different one
+	_stream.next_in = _inBuf + pos->inOffset;
 	_fileDone = false;
+
+	if (pos->peekLen > _peekSize) {
+		delete[] _peekBuf;
+		_peekBuf = new byte[pos->peekLen];
+		_peekSize = pos->peekLen;
+	}
+	if (pos->peekLen)
+		memcpy(_peekBuf, pos->peekBuf, pos->peekLen);
+	_peekPos = 0;
+	_peekLen = pos->peekLen;
 	return true;
 }
 
@@ -644,7 +983,7 @@ bool zlibFile::open(const char *filename) {
 		return false;
 
 	_handle = g_resourceloader->openNewStreamFile(filename);
-	if (!_handle->isOpen()) {
+	if (!_handle) {
 		if (gDebugLevel == DEBUG_SMUSH || gDebugLevel == DEBUG_WARN || gDebugLevel == DEBUG_ALL)
 			warning("zlibFile::open() zlibFile %s not found", filename);
 		return false;
@@ -692,24 +1031,64 @@ bool zlibFile::open(const char *filename) {
 
 void zlibFile::close() {
 	if (_handle) {
-		_handle->close();
 		delete _handle;
 		_handle = NULL;
 	}
 
 	delete[] _inBuf;
 	_inBuf = NULL;
+	delete[] _peekBuf;
+	_peekBuf = NULL;
+	_peekSize = 0;
+	_peekPos = 0;
+	_peekLen = 0;
 }
 
 bool zlibFile::isOpen() {
-	return _handle->isOpen();
+	return _handle != NULL;
 }
 
 uint32 zlibFile::read(void *ptr, uint32 len) {
+	uint32 peeked = MIN(len, _peekLen - _peekPos);
+
+	if (peeked) {
+		memcpy(ptr, _peekBuf + _peekPos, peeked);
+		_peekPos += peeked;
+		if (_peekPos == _peekLen)
+			_peekPos = _peekLen = 0;
+	}
+	return peeked + inflateData((byte *)ptr + peeked, len - peeked);
+}
+
+// Returns the next size bytes without reading them, or NULL if the file ends
+// before. The data stays valid until the next read or peek.
+const byte *zlibFile::peek(uint32 size) {
+	uint32 avail = _peekLen - _peekPos;
+
+	if (avail < size) {
+		if (size > _peekSize) {
+			byte *buf = new byte[size];
+			if (avail)
+				memcpy(buf, _peekBuf + _peekPos, avail);
+			delete[] _peekBuf;
+			_peekBuf = buf;
+			_peekSize = size;
+		} else if (avail) {
+			memmove(_peekBuf, _peekBuf + _peekPos, avail);
+		}
+		_peekPos = 0;
+		_peekLen = avail + inflateData(_peekBuf + avail, size - avail);
+		if (_peekLen < size)
+			return NULL;
+	}
+	return _peekBuf + _peekPos;
+}
+
+uint32 zlibFile::inflateData(void *ptr, uint32 len) {
 	int result = Z_OK;
 	bool fileEOF = false;
 
-	if (!_handle->isOpen()) {
+	if (!_handle) {
 		if (gDebugLevel == DEBUG_SMUSH || gDebugLevel == DEBUG_ERROR || gDebugLevel == DEBUG_ALL)
 			error("zlibFile::read() File is not open");
 		return 0;
@@ -33,6 +33,8 @@
 #endif
 
 #include "common/file.h"
+#include "common/array.h"
+#include "common/mutex.h"
 
 #include "engines/grim/smush/blocky8.h"
 #include "engines/grim/smush/blocky16.h"
@@ -48,14 +50,41 @@ struct SavePos {
 	uint32 filePos;
 	z_stream streamBuf;
 	byte *tmpBuf;
+	uint32 inOffset;	// next_in relative to the input buffer
+	byte *peekBuf;		// data peeked at but not read yet
+	uint32 peekLen;
 };
 
+// A position in the movie from which playback can resume without any earlier
+// frame: frame is a Blocky16 keyframe (or the first frame) and pos the inflate
+// state right before its FRME chunk.
+struct SmushCheckpoint {
+	int32 frame;
+	struct SavePos *pos;
+};
+
+// A decoded frame waiting in the decode-ahead ring
+struct SmushFrame {
+	byte *buffer;
+	bool video;	// false if the frame repeats the previous picture
+	int32 frame;
+	int32 movieTime;
+	int32 showTime;	// on the playback clock
+};
+
+// Number of frames decoded ahead of the one on screen
+#define SMUSH_RING_SIZE 4
+
 class zlibFile {
 private:
-	Common::File *_handle;
+	Common::SeekableReadStream *_handle;
 	z_stream _stream;	// Zlib stream
 	byte *_inBuf;		// Buffer for decompression
 	bool _fileDone;
+	byte *_peekBuf;		// Data inflated by peek() and not read yet
+	uint32 _peekSize, _peekPos, _peekLen;
+
+	uint32 inflateData(void *ptr, uint32 size);
 
 public:
 	zlibFile();
@@ -63,10 +92,12 @@ public:
 	bool setPos(struct SavePos *pos);
 	bool open(const char *filename);
 	struct SavePos *getPos();
+	static void deletePos(struct SavePos *pos);
 	void close();
 	bool isOpen();
 
 	uint32 read(void *ptr, uint32 size);
+	const byte *peek(uint32 size);
 	uint8 readByte();
 	uint16 readUint16LE();
 	uint32 readUint32LE();
@@ -94,10 +125,20 @@ private:
 	bool _videoFinished;
 	bool _videoPause;
 	bool _videoLooping;
-	struct SavePos *_startPos;
+	Common::Array<SmushCheckpoint> _checkpoints;
+	int32 _indexedFrames;
+	SmushFrame _ring[SMUSH_RING_SIZE];
+	int _ringHead, _ringCount;
+	int32 _decodeFrame;
+	bool _decodeDone;
+	int32 _decodeCount;	// frames decoded since the playback clock started
+	uint32 _startTime, _pauseTime;
+	Common::Mutex _mutex;
+	Common::Mutex _frameMutex;
 	int _x, _y;
 	int _width, _height;
 	byte *_internalBuffer, *_externalBuffer;
+	byte *_frontBuffer, *_spareBuffer;
 	byte _pal[0x300];
 	int16 _deltaPal[0x300];
 	byte _IACToutput[4096];
@@ -109,28 +150,40 @@ public:
 
 	bool play(const char *filename, bool looping, int x, int y);
 	void stop();
-	void pause(bool p) { _videoPause = p; }
+	void pause(bool p);
 	bool isPlaying() { return !_videoFinished; }
 	bool isUpdateNeeded() { return _updateNeeded; }
-	byte *getDstPtr() { return _externalBuffer; }
+	byte *takeFrame();
 	int getX() { return _x; }
 	int getY() { return _y; }
 	int getWidth() {return _width; }
 	int getHeight() { return _height; }
 	int getFrame() { return _frame; }
-	void clearUpdateNeeded() { _updateNeeded = false; }
 	int32 getMovieTime() { return _movieTime; }
+	bool seek(int32 frame);
 
 	void saveState(SaveGame *state);
 	void restoreState(SaveGame *state);
 
 private:
 	static void timerCallback(void *ptr);
+	static void decodeCallback(void *ptr);
 	void parseNextFrame();
 	void handleDeltaPalette(byte *src, int32 size);
 	void handleFramesHeader();
 	void handleFrameDemo();
 	void handleFrame();
+	bool decodeNextFrame();
+	void advanceDecoder();
+	byte *readFrame(int32 &size);
+	bool decodeFrame(const byte *frame, int32 size, byte *&buf, bool audio);
+	void presentBuffer(byte *&buf);
+	void stopAudio();
+	bool peekKeyframe();
+	bool checkpointDue(int32 frame);
+	void indexFrame(int32 frame, struct SavePos *pos);
+	int32 seekToCheckpoint(int32 frame);
+	void clearIndex();
 	void handleBlocky16(byte *src);
 	void handleWave(const byte *src, uint32 size);
 	void handleIACT(const byte *src, int32 size);
@@ -102,6 +102,20 @@ static int8 *offsets[] = {
 	imcOtherTable4, imcOtherTable5, imcOtherTable6
 };
 
+// Per step index data derived from the tables above, so the decoder
+// doesn't have to recompute it for every sample.
+struct VimaStep {
+	int numBits;
+	int highBit;
+	int lowBits;
+	int indexShift;
+	int deltaBase;
+};
+
+static VimaStep vimaSteps[89];
+// Step index following each (step index, magnitude) pair, already clipped
+static byte vimaNextStep[89 * 64];
+
 void vimaInit(uint16 *destTable) {
 	int destTableStartPos, incer;
 
@@ -118,8 +132,32 @@ void vimaInit(uint16 *destTable) {
 			destTable[destTablePos] = put;
 		}
 	}
+
+	for (int pos = 0; pos < 89; pos++) {
+		VimaStep &step = vimaSteps[pos];
+		step.numBits = imcTable2[pos];
+		step.highBit = 1 << (step.numBits - 1);
+		step.lowBits = step.highBit - 1;
+		step.indexShift = 7 - step.numBits;
+		step.deltaBase = imcTable1[pos] >> (step.numBits - 1);
+
+		for (int val = 0; val < 64; val++) {
+			int next = pos;
+			if (val <= step.lowBits)
+				next += offsets[step.numBits - 2][val];
+			if (next < 0)
+				next = 0;
+			else if (next > 88)
+				next = 88;
+			vimaNextStep[(pos << 6) | val] = next;
+		}
+	}
 }
 
+// The channels of a stereo block are stored one after the other in a
+// single bit stream, so they can only be decoded in sequence. The input
+// length isn't known either, so the bit reader keeps reading one byte
+// at a time and never looks further ahead than the stream requires.
 void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable) {
 	int numChannels = 1;
 	byte sBytes[2];
@@ -139,7 +177,7 @@ void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable
 	}
 
 	int numSamples = destLen / (numChannels * 2);
-	int bits = READ_BE_UINT16(src);
+	uint32 bits = READ_BE_UINT16(src);
 	int bitPtr = 0;
 	src += 2;
 
@@ -149,34 +187,28 @@ void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable
 		int outputWord = sWords[channel];
 
 		for (int sample = 0; sample < numSamples; sample++) {
-			int numBits = imcTable2[currTablePos];
-			bitPtr += numBits;
-			int highBit = 1 << (numBits - 1);
-			int lowBits = highBit - 1;
-			int val = (bits >> (16 - bitPtr)) & (highBit | lowBits);
+			const VimaStep &step = vimaSteps[currTablePos];
+			bitPtr += step.numBits;
+			int val = (bits >> (16 - bitPtr)) & (step.highBit | step.lowBits);
 
 			if (bitPtr > 7) {
 				bits = ((bits & 0xff) << 8) | *src++;
 				bitPtr -= 8;
 			}
 
-			if (val & highBit)
-				val ^= highBit;
-			else
-				highBit = 0;
+			int magnitude = val & step.lowBits;
 
-			if (val == lowBits) {
+			if (magnitude == step.lowBits) {
 				outputWord = ((int16)(bits << bitPtr) & 0xffffff00);
 				bits = ((bits & 0xff) << 8) | *src++;
 				outputWord |= ((bits >> (8 - bitPtr)) & 0xff);
 				bits = ((bits & 0xff) << 8) | *src++;
 			} else {
-				int index = (val << (7 - numBits)) | (currTablePos << 6);
-				int delta = destTable[index];
+				int delta = destTable[(magnitude << step.indexShift) | (currTablePos << 6)];
 
-				if (val)
-					delta += (imcTable1[currTablePos] >> (numBits - 1));
-				if (highBit)
+				if (magnitude)
+					delta += step.deltaBase;
+				if (val & step.highBit)
 					delta = -delta;
 
 				outputWord += delta;
@@ -189,12 +221,7 @@ void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable
 			WRITE_BE_UINT16(destPos, outputWord);
 			destPos += numChannels;
 
-			currTablePos += offsets[numBits - 2][val];
-
-			if (currTablePos < 0)
-				currTablePos = 0;
-			else if (currTablePos > 88)
-				currTablePos = 88;
+			currTablePos = vimaNextStep[(currTablePos << 6) | magnitude];
 		}
 	}
 }
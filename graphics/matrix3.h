@@ -82,6 +82,12 @@ public:
 
 		return *this;
 	}
+	bool operator ==(const Matrix3& s) const {
+		return _right == s._right && _up == s._up && _at == s._at;
+	}
+	bool operator !=(const Matrix3& s) const {
+		return !(*this == s);
+	}
 
 private:
 };
@@ -55,6 +55,13 @@ public:
 		return *this;
 	}
 
+	bool operator ==(const Matrix4& s) const {
+		return _pos == s._pos && _rot == s._rot;
+	}
+	bool operator !=(const Matrix4& s) const {
+		return !(*this == s);
+	}
+
 	void translate(float x, float y, float z);
 
 private:
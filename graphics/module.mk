@@ -36,7 +36,8 @@ MODULE_OBJS := \
 	tinygl/zline.o \
 	tinygl/zmath.o \
 	tinygl/ztriangle.o \
-	tinygl/ztriangle_shadow.o
+	tinygl/ztriangle_shadow.o \
+	tinygl/ztile.o
 
 # Include common rules
 include $(srcdir)/rules.mk
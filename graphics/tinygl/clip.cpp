@@ -389,20 +389,23 @@ void gl_draw_triangle_fill(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p
     
 	if (c->shadow_mode & 1) {
 		assert(c->zb->shadow_mask_buf);
-		ZB_fillTriangleFlatShadowMask(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		ZB_fillTriangle(c->zb, ZB_fillTriangleFlatShadowMask, &p0->zp, &p1->zp, &p2->zp);
 	} else if (c->shadow_mode & 2) {
 		assert(c->zb->shadow_mask_buf);
-		ZB_fillTriangleFlatShadow(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		ZB_fillTriangle(c->zb, ZB_fillTriangleFlatShadow, &p0->zp, &p1->zp, &p2->zp);
 	} else if (c->texture_2d_enabled) {
 #ifdef TINYGL_PROFILE
 		count_triangles_textured++;
 #endif
-		ZB_setTexture(c->zb, (PIXEL *)c->current_texture->images[0].pixmap);
-		ZB_fillTriangleMappingPerspective(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		{
+			GLImage *im = gl_select_texture_image(c, p0, p1, p2);
+			ZB_setTexture(c->zb, (PIXEL *)im->pixmap, im->xsize, im->ysize);
+		}
+		ZB_fillTriangle(c->zb, ZB_fillTriangleMappingPerspective, &p0->zp, &p1->zp, &p2->zp);
 	} else if (c->current_shade_model == TGL_SMOOTH) {
-		ZB_fillTriangleSmooth(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		ZB_fillTriangle(c->zb, ZB_fillTriangleSmooth, &p0->zp, &p1->zp, &p2->zp);
 	} else {
-		ZB_fillTriangleFlat(c->zb, &p0->zp, &p1->zp, &p2->zp);
+		ZB_fillTriangle(c->zb, ZB_fillTriangleFlat, &p0->zp, &p1->zp, &p2->zp);
 	}
 }
 
@@ -127,6 +127,7 @@ enum {
 	TGL_POLYGON_OFFSET_FILL			= 0x8037,
 	TGL_SHADOW_MASK_MODE			= 0x0C40,
 	TGL_SHADOW_MODE					= 0x0C41,
+	TGL_TILED_RASTER_MODE			= 0x0C42,
 
 	// Display Lists
 	TGL_COMPILE						= 0x1300,
@@ -796,6 +797,7 @@ void tglVertexPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid
 void tglColorPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer);
 void tglNormalPointer(TGLenum type, TGLsizei stride, const TGLvoid *pointer);
 void tglTexCoordPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoid *pointer);
+void tglDrawArrays(TGLenum mode, TGLint first, TGLsizei count);
 
 // opengl 1.2 polygon offset
 void tglPolygonOffset(TGLfloat factor, TGLfloat units);
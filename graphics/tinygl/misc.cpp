@@ -91,6 +91,9 @@ void glopEnableDisable(GLContext *c, GLParam *p) {
 		else
 			c->shadow_mode &= ~2;
 		break; 
+	case TGL_TILED_RASTER_MODE:
+		ZB_setTiled(c->zb, v);
+		break;
 	default:
 		if (code >= TGL_LIGHT0 && code < TGL_LIGHT0 + T_MAX_LIGHTS) {
 			gl_enable_disable_light(c, code - TGL_LIGHT0, v);
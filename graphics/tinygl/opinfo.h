@@ -64,6 +64,7 @@ ADD_OP(VertexPointer, 4, "%d %C %d %p")
 ADD_OP(ColorPointer, 4, "%d %C %d %p")
 ADD_OP(NormalPointer, 3, "%C %d %p")
 ADD_OP(TexCoordPointer, 4, "%d %C %d %p")
+ADD_OP(DrawArrays, 3, "%C %d %d")
 
 // opengl 1.1 polygon offset
 ADD_OP(PolygonOffset, 2, "%f %f")
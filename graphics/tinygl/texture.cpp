@@ -22,6 +22,9 @@ static void free_texture(GLContext *c, int h) {
 	GLImage *im;
 	int i;
 
+	// binned triangles may still sample from the texture
+	ZB_flushTiles(c->zb);
+
 	t = find_texture(c, h);
 	if (!t->prev) {
 		ht = &c->shared_state.texture_hash_table[t->handle % TEXTURE_HASH_TABLE_SIZE];
@@ -79,6 +82,46 @@ void glopBindTexture(GLContext *c, GLParam *p) {
 	c->current_texture = t;
 }
 
+// Returns the smallest power of two not below size, up to MAX_TEXTURE_SIZE.
+// gl_resizeImage() needs at least two texels per row and column.
+static int texture_size(int size) {
+	int s = 2;
+
+	while (s < size && s < MAX_TEXTURE_SIZE)
+		s <<= 1;
+	return s;
+}
+
+// Picks the image of the current texture to draw the triangle with: the
+// mip level whose texels map closest to one pixel each, when there are any.
+GLImage *gl_select_texture_image(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p2) {
+	GLTexture *t = c->current_texture;
+	GLImage *im = &t->images[0];
+	float pixels, st;
+	int level;
+
+	if (!t->mipmapped)
+		return im;
+
+	// twice the area of the triangle, on screen and in texture coordinates
+	pixels = (float)((p1->zp.x - p0->zp.x) * (p2->zp.y - p0->zp.y) -
+					 (p2->zp.x - p0->zp.x) * (p1->zp.y - p0->zp.y));
+	st = (p1->tex_coord.X - p0->tex_coord.X) * (p2->tex_coord.Y - p0->tex_coord.Y) -
+		 (p2->tex_coord.X - p0->tex_coord.X) * (p1->tex_coord.Y - p0->tex_coord.Y);
+	if (pixels < 0)
+		pixels = -pixels;
+	if (st < 0)
+		st = -st;
+
+	// each level has a quarter of the texels of the previous one
+	for (level = 1; level < MAX_TEXTURE_LEVELS && t->images[level].pixmap; level++) {
+		if (st * im->xsize * im->ysize < 4 * pixels)
+			break;
+		im = &t->images[level];
+	}
+	return im;
+}
+
 void glopTexImage2D(GLContext *c, GLParam *p) {
 	int target = p[1].i;
 	int level = p[2].i;
@@ -91,23 +134,27 @@ void glopTexImage2D(GLContext *c, GLParam *p) {
 	void *pixels = p[9].p;
 	GLImage *im;
 	unsigned char *pixels1;
-	int do_free;
+	int xsize, ysize, do_free;
 
-	if (!(target == TGL_TEXTURE_2D && level == 0 && components == 3 && border == 0
-				&& format == TGL_RGBA && type == TGL_UNSIGNED_BYTE)) {
+	if (!(target == TGL_TEXTURE_2D && level >= 0 && level < MAX_TEXTURE_LEVELS && components == 3
+				&& border == 0 && format == TGL_RGBA && type == TGL_UNSIGNED_BYTE)) {
 		error("glTexImage2D: combination of parameters not handled");
 	}
 
+	// the fillers address power of two textures of up to MAX_TEXTURE_SIZE
+	// texels at their own size, only the other ones get resampled
+	xsize = texture_size(width);
+	ysize = texture_size(height);
 	do_free = 0;
-	if (width != 256 || height != 256) {
-		pixels1 = (unsigned char *)gl_malloc(256 * 256 * 4);
+	if (width != xsize || height != ysize) {
+		pixels1 = (unsigned char *)gl_malloc(xsize * ysize * 4);
 		// no interpolation is done here to respect the original image aliasing !
-		//gl_resizeImageNoInterpolate(pixels1, 256, 256, (unsigned char *)pixels, width, height);
+		//gl_resizeImageNoInterpolate(pixels1, xsize, ysize, (unsigned char *)pixels, width, height);
 		// used interpolation anyway, it look much better :) --- aquadran
-		gl_resizeImage(pixels1, 256, 256, (unsigned char *)pixels, width, height);
+		gl_resizeImage(pixels1, xsize, ysize, (unsigned char *)pixels, width, height);
 		do_free = 1;
-		width = 256;
-		height = 256;
+		width = xsize;
+		height = ysize;
 	} else {
 		pixels1 = (unsigned char *)pixels;
 	}
@@ -115,8 +162,10 @@ void glopTexImage2D(GLContext *c, GLParam *p) {
 	im = &c->current_texture->images[level];
 	im->xsize = width;
 	im->ysize = height;
-	if (im->pixmap)
+	if (im->pixmap) {
+		ZB_flushTiles(c->zb);
 		gl_free(im->pixmap);
+	}
 	im->pixmap = gl_malloc(width * height * 3);
 	if (im->pixmap)
 		gl_convertRGB_to_5R6G5B8A((unsigned short *)im->pixmap, pixels1, width, height);
@@ -143,7 +192,7 @@ error:
 }
 
 // TODO: not all tests are done
-void glopTexParameter(GLContext *, GLParam *p) {
+void glopTexParameter(GLContext *c, GLParam *p) {
 	int target = p[1].i;
 	int pname = p[2].i;
 	int param = p[3].i;
@@ -159,6 +208,10 @@ error:
 		if (param != TGL_REPEAT)
 			goto error;
 		break;
+	case TGL_TEXTURE_MIN_FILTER:
+		c->current_texture->mipmapped = param == TGL_NEAREST_MIPMAP_NEAREST || param == TGL_NEAREST_MIPMAP_LINEAR ||
+										param == TGL_LINEAR_MIPMAP_NEAREST || param == TGL_LINEAR_MIPMAP_LINEAR;
+		break;
 	default:
 		;
 	}
@@ -4,6 +4,7 @@
 #include "common/scummsys.h"
 
 #include "graphics/tinygl/zbuffer.h"
+#include "graphics/tinygl/zspan.h"
 
 namespace TinyGL {
 
@@ -54,8 +55,23 @@ ZBuffer *ZB_open(int xsize, int ysize, int mode, void *frame_buffer) {
 	}
 
 	zb->current_texture = NULL;
+	zb->texture_s_mask = 0;
+	zb->texture_t_mask = 0;
+	zb->texture_s_shift = 0;
+	zb->texture_t_shift = 0;
 	zb->shadow_mask_buf = NULL;
 
+	zb->band_ymin = 0;
+	zb->band_ymax = zb->ysize;
+	zb->tiled = 0;
+	zb->tile_tris = NULL;
+	zb->tile_tris_count = 0;
+	zb->tile_tris_allocated = 0;
+
+	zb->simd_spans = ZB_hasSIMDSpans();
+
+	ZB_resetDirty(zb);
+
 	return zb;
 error:
 	gl_free(zb);
@@ -68,17 +84,22 @@ void ZB_close(ZBuffer *zb) {
 
     gl_free(zb->zbuf);
     gl_free(zb->zbuf2);
+    if (zb->tile_tris)
+        gl_free(zb->tile_tris);
     gl_free(zb);
 }
 
 void ZB_resize(ZBuffer *zb, void *frame_buffer, int xsize, int ysize) {
 	int size;
 
+	ZB_flushTiles(zb);
+
 	// xsize must be a multiple of 4
 	xsize = xsize & ~3;
 
 	zb->xsize = xsize;
 	zb->ysize = ysize;
+	zb->band_ymax = ysize;
 	zb->linesize = (xsize * PSZB + 3) & ~3;
 
 	size = zb->xsize * zb->ysize * sizeof(unsigned short);
@@ -119,6 +140,8 @@ static void ZB_copyBuffer(ZBuffer *zb, void *buf, int linesize) {
 }
 
 void ZB_copyFrameBuffer(ZBuffer *zb, void *buf, int linesize) {
+	ZB_flushTiles(zb);
+
 	switch (zb->mode) {
 	case ZB_MODE_5R6G5B:
 		ZB_copyBuffer(zb, buf, linesize);
@@ -172,11 +195,34 @@ void memset_l(void *adr, int val, int count) {
 	*p++ = val;
 }
 
+void ZB_resetDirty(ZBuffer *zb) {
+	zb->dirty_x1 = zb->xsize;
+	zb->dirty_y1 = zb->ysize;
+	zb->dirty_x2 = 0;
+	zb->dirty_y2 = 0;
+}
+
+void ZB_markDirty(ZBuffer *zb, int x, int y) {
+	if (x < zb->dirty_x1)
+		zb->dirty_x1 = x;
+	if (y < zb->dirty_y1)
+		zb->dirty_y1 = y;
+	if (x >= zb->dirty_x2)
+		zb->dirty_x2 = x + 1;
+	if (y >= zb->dirty_y2)
+		zb->dirty_y2 = y + 1;
+}
+
 void ZB_clear(ZBuffer *zb, int clear_z, int z, int clear_color, int r, int g, int b) {
 	int color;
 	int y;
 	PIXEL *pp;
 
+	ZB_flushTiles(zb);
+
+	ZB_markDirty(zb, 0, 0);
+	ZB_markDirty(zb, zb->xsize - 1, zb->ysize - 1);
+
 	if (clear_z) {
 		memset_s(zb->zbuf, z, zb->xsize * zb->ysize);
 	}
@@ -9,6 +9,9 @@ namespace TinyGL {
 
 #define ZB_POINT_Z_FRAC_BITS 14
 
+// s and t cover one repetition of the texture in ZB_POINT_ST_BITS bits
+#define ZB_POINT_ST_BITS 22
+
 #define ZB_POINT_S_MIN ( (1 << 13) )
 #define ZB_POINT_S_MAX ( (1 << 22) - (1 << 13) )
 #define ZB_POINT_T_MIN ( (1 << 21) )
@@ -30,6 +33,19 @@ typedef unsigned short PIXEL;
 #define PSZB 2 
 #define PSZSH 4 
 
+// height in scanlines of the screen tiles used by the binned rasterizer
+#define ZB_TILE_HEIGHT 32
+
+typedef struct {
+	int x,y,z;     // integer coordinates in the zbuffer
+	int s,t;       // coordinates for the mapping
+	int r,g,b;     // color indexes
+  
+	float sz,tz;   // temporary coordinates for mapping
+} ZBufferPoint;
+
+struct ZBufferTriangle;
+
 typedef struct {
 	int xsize, ysize;
 	int linesize; // line size, in bytes
@@ -47,15 +63,26 @@ typedef struct {
 	unsigned char *dctable;
 	int *ctable;
 	PIXEL *current_texture;
-} ZBuffer;
+	// texel addressing of current_texture, see ZB_setTexture()
+	unsigned int texture_s_mask, texture_t_mask;
+	int texture_s_shift, texture_t_shift;
 
-typedef struct {
-	int x,y,z;     // integer coordinates in the zbuffer
-	int s,t;       // coordinates for the mapping
-	int r,g,b;     // color indexes
-  
-	float sz,tz;   // temporary coordinates for mapping
-} ZBufferPoint;
+	// only the scanlines in [band_ymin, band_ymax) are rasterized
+	int band_ymin, band_ymax;
+
+	// when tiled is set triangles are recorded and rasterized one tile
+	// at a time by ZB_flushTiles()
+	int tiled;
+	ZBufferTriangle *tile_tris;
+	int tile_tris_count;
+	int tile_tris_allocated;
+
+	// use the 8 pixel span kernels of zspan.h when they are available
+	int simd_spans;
+
+	// bounding box of what was drawn since ZB_resetDirty(), x2 and y2 excluded
+	int dirty_x1, dirty_y1, dirty_x2, dirty_y2;
+} ZBuffer;
 
 // zbuffer.c
 
@@ -65,6 +92,8 @@ void ZB_resize(ZBuffer *zb, void *frame_buffer, int xsize, int ysize);
 void ZB_clear(ZBuffer *zb, int clear_z, int z, int clear_color, int r, int g, int b);
 // linesize is in BYTES
 void ZB_copyFrameBuffer(ZBuffer *zb, void *buf, int linesize);
+void ZB_resetDirty(ZBuffer *zb);
+void ZB_markDirty(ZBuffer *zb, int x, int y);
 
 // zline.c
 
@@ -74,7 +103,7 @@ void ZB_line_z(ZBuffer * zb, ZBufferPoint * p1, ZBufferPoint * p2);
 
 // ztriangle.c */
 
-void ZB_setTexture(ZBuffer *zb, PIXEL *texture);
+void ZB_setTexture(ZBuffer *zb, PIXEL *texture, int xsize, int ysize);
 void ZB_fillTriangleFlat(ZBuffer *zb, ZBufferPoint *p1, 
 						 ZBufferPoint *p2, ZBufferPoint *p3);
 void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p1, 
@@ -90,6 +119,35 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0,
 typedef void (*ZB_fillTriangleFunc)(ZBuffer *, ZBufferPoint *,
 									ZBufferPoint *, ZBufferPoint *);
 
+// ztile.c
+
+// a triangle recorded for the binned rasterizer, along with the zbuffer
+// state the fillers read while drawing it
+struct ZBufferTriangle {
+	ZB_fillTriangleFunc fill;
+	ZBufferPoint p0, p1, p2;
+	PIXEL *texture;
+	unsigned int texture_s_mask, texture_t_mask;
+	int texture_s_shift, texture_t_shift;
+	unsigned char *shadow_mask_buf;
+	int shadow_color_r, shadow_color_g, shadow_color_b;
+};
+
+void ZB_fillTriangle(ZBuffer *zb, ZB_fillTriangleFunc fill, ZBufferPoint *p0,
+					 ZBufferPoint *p1, ZBufferPoint *p2);
+void ZB_setTiled(ZBuffer *zb, int tiled);
+void ZB_flushTiles(ZBuffer *zb);
+
+// Steps the left edge error term of the triangle fillers over lines
+// scanlines at once. Returns how many of them take the dxdy_max step and
+// leaves error where the line by line walk would.
+static inline int ZB_skipEdgeLines(int *error, int derror, int lines) {
+	int e = *error + lines * derror;
+	int nb_max = e > 0 ? (e + 0xffff) >> 16 : 0;
+	*error = e - (nb_max << 16);
+	return nb_max;
+}
+
 // memory.c
 void gl_free(void *p);
 void *gl_malloc(int size);
@@ -34,6 +34,7 @@ enum {
 #define MAX_TEXTURE_STACK_DEPTH		8
 #define MAX_NAME_STACK_DEPTH		64
 #define MAX_TEXTURE_LEVELS			11
+#define MAX_TEXTURE_SIZE			256
 #define T_MAX_LIGHTS				16
 
 #define VERTEX_HASH_SIZE 1031
@@ -134,6 +135,7 @@ typedef struct GLImage {
 typedef struct GLTexture {
 	GLImage images[MAX_TEXTURE_LEVELS];
 	int handle;
+	int mipmapped; // the min filter samples from the mip levels
 	struct GLTexture *next, *prev;
 } GLTexture;
 
@@ -299,6 +301,7 @@ void gl_shade_vertex(GLContext *c, GLVertex *v);
 void glInitTextures(GLContext *c);
 void glEndTextures(GLContext *c);
 GLTexture *alloc_texture(GLContext *c, int h);
+GLImage *gl_select_texture_image(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p2);
 
 // image_util.c
 void gl_convertRGB_to_5R6G5B8A(unsigned short *pixmap, unsigned char *rgba, int xsize, int ysize);
@@ -0,0 +1,174 @@
+#ifndef GRAPHICS_TINYGL_ZSPAN_H_
+#define GRAPHICS_TINYGL_ZSPAN_H_
+
+// Span kernels handling 8 pixels per step. They are only built when the
+// compiler targets SSE2 or NEON; the triangle fillers then use them when
+// zb->simd_spans is set and fall back to their scalar loops otherwise.
+//
+// The kernels evaluate the same depth test as the scalar PUT_PIXEL macros,
+// for z, z + dzdx, ..., z + 7 * dzdx, so the results are pixel exact.
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define ZB_SIMD_SPANS
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ZB_SIMD_SPANS
+#endif
+
+#include "graphics/tinygl/zbuffer.h"
+
+namespace TinyGL {
+
+#ifdef ZB_SIMD_SPANS
+
+#if defined(__SSE2__)
+
+// z values of pixels 0-3 and 4-7
+static inline void ZB_spanZ8(unsigned int z, unsigned int dzdx, __m128i *z_lo, __m128i *z_hi) {
+	*z_lo = _mm_set_epi32(z + 3 * dzdx, z + 2 * dzdx, z + dzdx, z);
+	*z_hi = _mm_add_epi32(*z_lo, _mm_set1_epi32(4 * dzdx));
+}
+
+// all bits set in the lanes passing the test
+static inline __m128i ZB_spanZTest4(__m128i z, __m128i pz, __m128i pz_2) {
+	const __m128i sign = _mm_set1_epi32(0x80000000);
+	// z >> ZB_POINT_Z_FRAC_BITS and pz both fit in 18 bits: a signed compare is enough
+	__m128i fail = _mm_cmpgt_epi32(pz, _mm_srli_epi32(z, ZB_POINT_Z_FRAC_BITS));
+	fail = _mm_or_si128(fail, _mm_cmpgt_epi32(_mm_xor_si128(pz_2, sign), _mm_xor_si128(z, sign)));
+	return _mm_xor_si128(fail, _mm_set1_epi32(-1));
+}
+
+static inline void ZB_spanZTest8(const unsigned short *pz, const unsigned int *pz_2,
+								 __m128i z_lo, __m128i z_hi, __m128i *pass_lo, __m128i *pass_hi) {
+	const __m128i zero = _mm_setzero_si128();
+	__m128i pz16 = _mm_loadu_si128((const __m128i *)pz);
+	*pass_lo = ZB_spanZTest4(z_lo, _mm_unpacklo_epi16(pz16, zero), _mm_loadu_si128((const __m128i *)pz_2));
+	*pass_hi = ZB_spanZTest4(z_hi, _mm_unpackhi_epi16(pz16, zero), _mm_loadu_si128((const __m128i *)(pz_2 + 4)));
+}
+
+// Returns a mask with bit i set when pixel i passes the depth test.
+static inline int ZB_depthTestSpan8(const unsigned short *pz, const unsigned int *pz_2,
+									unsigned int z, unsigned int dzdx) {
+	__m128i z_lo, z_hi, pass_lo, pass_hi;
+
+	ZB_spanZ8(z, dzdx, &z_lo, &z_hi);
+	ZB_spanZTest8(pz, pz_2, z_lo, z_hi, &pass_lo, &pass_hi);
+	return _mm_movemask_ps(_mm_castsi128_ps(pass_lo)) | (_mm_movemask_ps(_mm_castsi128_ps(pass_hi)) << 4);
+}
+
+// Writes color and z to the pixels passing the depth test whose bit is set in enable.
+static inline void ZB_fillSpanFlat8(PIXEL *pp, const unsigned short *pz, unsigned int *pz_2,
+									unsigned int z, unsigned int dzdx, PIXEL color, int enable) {
+	const __m128i bits_lo = _mm_set_epi32(8, 4, 2, 1);
+	const __m128i bits_hi = _mm_set_epi32(128, 64, 32, 16);
+	__m128i z_lo, z_hi, pass_lo, pass_hi, pass, en, p;
+
+	ZB_spanZ8(z, dzdx, &z_lo, &z_hi);
+	ZB_spanZTest8(pz, pz_2, z_lo, z_hi, &pass_lo, &pass_hi);
+	en = _mm_set1_epi32(enable);
+	pass_lo = _mm_and_si128(pass_lo, _mm_cmpeq_epi32(_mm_and_si128(en, bits_lo), bits_lo));
+	pass_hi = _mm_and_si128(pass_hi, _mm_cmpeq_epi32(_mm_and_si128(en, bits_hi), bits_hi));
+
+	p = _mm_loadu_si128((const __m128i *)pz_2);
+	p = _mm_or_si128(_mm_and_si128(pass_lo, z_lo), _mm_andnot_si128(pass_lo, p));
+	_mm_storeu_si128((__m128i *)pz_2, p);
+	p = _mm_loadu_si128((const __m128i *)(pz_2 + 4));
+	p = _mm_or_si128(_mm_and_si128(pass_hi, z_hi), _mm_andnot_si128(pass_hi, p));
+	_mm_storeu_si128((__m128i *)(pz_2 + 4), p);
+
+	// the lane masks are 0 or -1, so the saturating pack keeps them intact
+	pass = _mm_packs_epi32(pass_lo, pass_hi);
+	p = _mm_loadu_si128((const __m128i *)pp);
+	p = _mm_or_si128(_mm_and_si128(pass, _mm_set1_epi16((short)color)), _mm_andnot_si128(pass, p));
+	_mm_storeu_si128((__m128i *)pp, p);
+}
+
+#else
+
+static inline void ZB_spanZ8(unsigned int z, unsigned int dzdx, uint32x4_t *z_lo, uint32x4_t *z_hi) {
+	unsigned int zs[4] = { z, z + dzdx, z + 2 * dzdx, z + 3 * dzdx };
+	*z_lo = vld1q_u32(zs);
+	*z_hi = vaddq_u32(*z_lo, vdupq_n_u32(4 * dzdx));
+}
+
+static inline void ZB_spanZTest8(const unsigned short *pz, const unsigned int *pz_2,
+								 uint32x4_t z_lo, uint32x4_t z_hi, uint32x4_t *pass_lo, uint32x4_t *pass_hi) {
+	uint16x8_t pz16 = vld1q_u16(pz);
+	*pass_lo = vandq_u32(vcgeq_u32(vshrq_n_u32(z_lo, ZB_POINT_Z_FRAC_BITS), vmovl_u16(vget_low_u16(pz16))),
+						 vcgeq_u32(z_lo, vld1q_u32(pz_2)));
+	*pass_hi = vandq_u32(vcgeq_u32(vshrq_n_u32(z_hi, ZB_POINT_Z_FRAC_BITS), vmovl_u16(vget_high_u16(pz16))),
+						 vcgeq_u32(z_hi, vld1q_u32(pz_2 + 4)));
+}
+
+static inline int ZB_spanMask4(uint32x4_t pass, const unsigned int *bits) {
+	uint32x4_t m = vandq_u32(pass, vld1q_u32(bits));
+	uint32x2_t h = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+	return vget_lane_u32(vpadd_u32(h, h), 0);
+}
+
+// Returns a mask with bit i set when pixel i passes the depth test.
+static inline int ZB_depthTestSpan8(const unsigned short *pz, const unsigned int *pz_2,
+									unsigned int z, unsigned int dzdx) {
+	static const unsigned int bits[4] = { 1, 2, 4, 8 };
+	uint32x4_t z_lo, z_hi, pass_lo, pass_hi;
+
+	ZB_spanZ8(z, dzdx, &z_lo, &z_hi);
+	ZB_spanZTest8(pz, pz_2, z_lo, z_hi, &pass_lo, &pass_hi);
+	return ZB_spanMask4(pass_lo, bits) | (ZB_spanMask4(pass_hi, bits) << 4);
+}
+
+// Writes color and z to the pixels passing the depth test whose bit is set in enable.
+static inline void ZB_fillSpanFlat8(PIXEL *pp, const unsigned short *pz, unsigned int *pz_2,
+									unsigned int z, unsigned int dzdx, PIXEL color, int enable) {
+	static const unsigned int bits[8] = { 1, 2, 4, 8, 16, 32, 64, 128 };
+	uint32x4_t z_lo, z_hi, pass_lo, pass_hi, en;
+	uint16x8_t pass;
+
+	ZB_spanZ8(z, dzdx, &z_lo, &z_hi);
+	ZB_spanZTest8(pz, pz_2, z_lo, z_hi, &pass_lo, &pass_hi);
+	en = vdupq_n_u32(enable);
+	pass_lo = vandq_u32(pass_lo, vtstq_u32(en, vld1q_u32(bits)));
+	pass_hi = vandq_u32(pass_hi, vtstq_u32(en, vld1q_u32(bits + 4)));
+
+	vst1q_u32(pz_2, vbslq_u32(pass_lo, z_lo, vld1q_u32(pz_2)));
+	vst1q_u32(pz_2 + 4, vbslq_u32(pass_hi, z_hi, vld1q_u32(pz_2 + 4)));
+
+	pass = vcombine_u16(vmovn_u32(pass_lo), vmovn_u32(pass_hi));
+	vst1q_u16(pp, vbslq_u16(pass, vdupq_n_u16(color), vld1q_u16(pp)));
+}
+
+#endif
+
+#endif
+
+// Draws the 8 pixel groups of a span with PUT_PIXELS8(), leaving the
+// remaining pixels to the scalar loops.
+#ifdef ZB_SIMD_SPANS
+#define DRAW_SPANS8() {							\
+	if (zb->simd_spans) {						\
+		while (n >= 7) {						\
+			PUT_PIXELS8();						\
+			pz += 8;							\
+			pz_2 += 8;							\
+			pp = (PIXEL *)((char *)pp + 8 * PSZB);	\
+			n -= 8;								\
+		}										\
+	}											\
+}
+#else
+#define DRAW_SPANS8() {}
+#endif
+
+// Whether the span kernels above were built in.
+static inline int ZB_hasSIMDSpans() {
+#ifdef ZB_SIMD_SPANS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+} // end of namespace TinyGL
+
+#endif
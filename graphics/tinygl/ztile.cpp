@@ -0,0 +1,166 @@
+// Binned rasterization: triangles are recorded and later drawn one
+// horizontal screen tile at a time, so the color, z and shadow buffers of a
+// tile stay in cache while all the triangles touching it are filled.
+//
+// Each filler walks its edges exactly as in the immediate path and only
+// skips the spans outside the current tile, so the output is identical.
+// Tiles don't overlap, which also makes them independent units of work.
+
+#include "common/scummsys.h"
+
+#include "graphics/tinygl/zbuffer.h"
+
+namespace TinyGL {
+
+void ZB_fillTriangle(ZBuffer *zb, ZB_fillTriangleFunc fill, ZBufferPoint *p0,
+					 ZBufferPoint *p1, ZBufferPoint *p2) {
+	ZBufferTriangle *tri;
+
+	ZB_markDirty(zb, p0->x, p0->y);
+	ZB_markDirty(zb, p1->x, p1->y);
+	ZB_markDirty(zb, p2->x, p2->y);
+
+	if (!zb->tiled) {
+		fill(zb, p0, p1, p2);
+		return;
+	}
+
+	if (zb->tile_tris_count == zb->tile_tris_allocated) {
+		int n = zb->tile_tris_allocated ? zb->tile_tris_allocated * 2 : 256;
+		ZBufferTriangle *tris = (ZBufferTriangle *)gl_malloc(n * sizeof(ZBufferTriangle));
+		if (zb->tile_tris) {
+			memcpy(tris, zb->tile_tris, zb->tile_tris_count * sizeof(ZBufferTriangle));
+			gl_free(zb->tile_tris);
+		}
+		zb->tile_tris = tris;
+		zb->tile_tris_allocated = n;
+	}
+
+	tri = &zb->tile_tris[zb->tile_tris_count++];
+	tri->fill = fill;
+	tri->p0 = *p0;
+	tri->p1 = *p1;
+	tri->p2 = *p2;
+	tri->texture = zb->current_texture;
+	tri->texture_s_mask = zb->texture_s_mask;
+	tri->texture_t_mask = zb->texture_t_mask;
+	tri->texture_s_shift = zb->texture_s_shift;
+	tri->texture_t_shift = zb->texture_t_shift;
+	tri->shadow_mask_buf = zb->shadow_mask_buf;
+	tri->shadow_color_r = zb->shadow_color_r;
+	tri->shadow_color_g = zb->shadow_color_g;
+	tri->shadow_color_b = zb->shadow_color_b;
+}
+
+void ZB_setTiled(ZBuffer *zb, int tiled) {
+	if (!tiled)
+		ZB_flushTiles(zb);
+	zb->tiled = tiled;
+}
+
+static void ZB_triangleTiles(ZBufferTriangle *tri, int nb_tiles, int *first, int *last) {
+	int ymin = tri->p0.y, ymax = tri->p0.y;
+
+	if (tri->p1.y < ymin)
+		ymin = tri->p1.y;
+	if (tri->p1.y > ymax)
+		ymax = tri->p1.y;
+	if (tri->p2.y < ymin)
+		ymin = tri->p2.y;
+	if (tri->p2.y > ymax)
+		ymax = tri->p2.y;
+
+	*first = ymin / ZB_TILE_HEIGHT;
+	*last = ymax / ZB_TILE_HEIGHT;
+	if (*first < 0)
+		*first = 0;
+	if (*last >= nb_tiles)
+		*last = nb_tiles - 1;
+}
+
+void ZB_flushTiles(ZBuffer *zb) {
+	int nb_tiles, nb_refs, i, j, first, last;
+	int *tile_start, *tile_tris;
+	PIXEL *texture;
+	unsigned int texture_s_mask, texture_t_mask;
+	int texture_s_shift, texture_t_shift;
+	unsigned char *shadow_mask_buf;
+	int shadow_color_r, shadow_color_g, shadow_color_b;
+
+	if (zb->tile_tris_count == 0)
+		return;
+
+	nb_tiles = (zb->ysize + ZB_TILE_HEIGHT - 1) / ZB_TILE_HEIGHT;
+
+	// bin the triangles: count the references of each tile, then lay
+	// them out contiguously, keeping submission order inside a tile
+	tile_start = (int *)gl_zalloc((nb_tiles + 1) * sizeof(int));
+	for (i = 0; i < zb->tile_tris_count; i++) {
+		ZB_triangleTiles(&zb->tile_tris[i], nb_tiles, &first, &last);
+		for (j = first; j <= last; j++)
+			tile_start[j + 1]++;
+	}
+	for (j = 0; j < nb_tiles; j++)
+		tile_start[j + 1] += tile_start[j];
+	nb_refs = tile_start[nb_tiles];
+
+	tile_tris = (int *)gl_malloc(nb_refs * sizeof(int));
+	for (i = 0; i < zb->tile_tris_count; i++) {
+		ZB_triangleTiles(&zb->tile_tris[i], nb_tiles, &first, &last);
+		for (j = first; j <= last; j++)
+			tile_tris[tile_start[j]++] = i;
+	}
+	// tile_start[j] now holds the end of tile j, i.e. the start of tile j + 1
+	for (j = nb_tiles; j > 0; j--)
+		tile_start[j] = tile_start[j - 1];
+	tile_start[0] = 0;
+
+	texture = zb->current_texture;
+	texture_s_mask = zb->texture_s_mask;
+	texture_t_mask = zb->texture_t_mask;
+	texture_s_shift = zb->texture_s_shift;
+	texture_t_shift = zb->texture_t_shift;
+	shadow_mask_buf = zb->shadow_mask_buf;
+	shadow_color_r = zb->shadow_color_r;
+	shadow_color_g = zb->shadow_color_g;
+	shadow_color_b = zb->shadow_color_b;
+
+	for (j = 0; j < nb_tiles; j++) {
+		zb->band_ymin = j * ZB_TILE_HEIGHT;
+		zb->band_ymax = zb->band_ymin + ZB_TILE_HEIGHT;
+		for (i = tile_start[j]; i < tile_start[j + 1]; i++) {
+			ZBufferTriangle *tri = &zb->tile_tris[tile_tris[i]];
+			// the fillers write temporaries into the points
+			ZBufferPoint p0 = tri->p0, p1 = tri->p1, p2 = tri->p2;
+
+			zb->current_texture = tri->texture;
+			zb->texture_s_mask = tri->texture_s_mask;
+			zb->texture_t_mask = tri->texture_t_mask;
+			zb->texture_s_shift = tri->texture_s_shift;
+			zb->texture_t_shift = tri->texture_t_shift;
+			zb->shadow_mask_buf = tri->shadow_mask_buf;
+			zb->shadow_color_r = tri->shadow_color_r;
+			zb->shadow_color_g = tri->shadow_color_g;
+			zb->shadow_color_b = tri->shadow_color_b;
+			tri->fill(zb, &p0, &p1, &p2);
+		}
+	}
+
+	zb->band_ymin = 0;
+	zb->band_ymax = zb->ysize;
+	zb->current_texture = texture;
+	zb->texture_s_mask = texture_s_mask;
+	zb->texture_t_mask = texture_t_mask;
+	zb->texture_s_shift = texture_s_shift;
+	zb->texture_t_shift = texture_t_shift;
+	zb->shadow_mask_buf = shadow_mask_buf;
+	zb->shadow_color_r = shadow_color_r;
+	zb->shadow_color_g = shadow_color_g;
+	zb->shadow_color_b = shadow_color_b;
+	zb->tile_tris_count = 0;
+
+	gl_free(tile_tris);
+	gl_free(tile_start);
+}
+
+} // end of namespace TinyGL
@@ -1,5 +1,6 @@
 
 #include "graphics/tinygl/zbuffer.h"
+#include "graphics/tinygl/zspan.h"
 
 namespace TinyGL {
 
@@ -23,6 +24,11 @@ void ZB_fillTriangleFlat(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuffe
 	z += dzdx;								\
 }
 
+#define PUT_PIXELS8() {							\
+	ZB_fillSpanFlat8(pp, pz, pz_2, z, dzdx, color, 0xff);	\
+	z += 8 * (unsigned int)dzdx;				\
+}
+
 #include "graphics/tinygl/ztriangle.h"
 }
 
@@ -54,6 +60,26 @@ void ZB_fillTriangleSmooth(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuf
 	rgb = (rgb + drgbdx) & (~0x00200800);	\
 }
 
+// the color steps don't vectorize exactly, only the depth test does
+#define PUT_PIXELS8() {								\
+	int mask = ZB_depthTestSpan8(pz, pz_2, z, dzdx);	\
+	if (mask) {										\
+		for (int _a = 0; _a < 8; _a++) {			\
+			if (mask & (1 << _a)) {					\
+				tmp = rgb & 0xF81F07E0;				\
+				pp[_a] = tmp | (tmp >> 16);			\
+				pz_2[_a] = z;						\
+			}										\
+			z += dzdx;								\
+			rgb = (rgb + drgbdx) & (~0x00200800);	\
+		}											\
+	} else {										\
+		z += 8 * (unsigned int)dzdx;				\
+		for (int _a = 0; _a < 8; _a++)				\
+			rgb = (rgb + drgbdx) & (~0x00200800);	\
+	}												\
+}
+
 #define DRAW_LINE()	{								\
 	register unsigned short *pz;					\
 	register unsigned int *pz_2;					\
@@ -69,6 +95,7 @@ void ZB_fillTriangleSmooth(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuf
 	rgb |= (g1 >> 5) & 0x000007FF;					\
 	rgb |= (b1 << 5) & 0x001FF000;					\
 	drgbdx = _drgbdx;								\
+	DRAW_SPANS8();									\
 	while (n >= 3) {								\
 		PUT_PIXEL(0);								\
 		PUT_PIXEL(1);								\
@@ -91,24 +118,45 @@ void ZB_fillTriangleSmooth(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBuf
 #include "graphics/tinygl/ztriangle.h"
 }
 
-void ZB_setTexture(ZBuffer *zb, PIXEL *texture) {
-	zb->current_texture=texture;
+// The texture is xsize * ysize texels of 3 bytes, both sizes being powers
+// of two. The texel at s, t is at index (t & t_mask) >> t_shift | (s & s_mask) >> s_shift.
+void ZB_setTexture(ZBuffer *zb, PIXEL *texture, int xsize, int ysize) {
+	int s_bits = 0, t_bits = 0;
+
+	while ((1 << s_bits) < xsize)
+		s_bits++;
+	while ((1 << t_bits) < ysize)
+		t_bits++;
+
+	zb->current_texture = texture;
+	zb->texture_s_shift = ZB_POINT_ST_BITS - s_bits;
+	zb->texture_s_mask = (xsize - 1) << zb->texture_s_shift;
+	zb->texture_t_shift = ZB_POINT_ST_BITS - t_bits - s_bits;
+	zb->texture_t_mask = (ysize - 1) << (ZB_POINT_ST_BITS - t_bits);
 }
 
 void ZB_fillTriangleMapping(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2) {
 	PIXEL *texture;
+	unsigned int s_mask, t_mask;
+	int s_shift, t_shift;
 
 #define INTERP_Z
 #define INTERP_ST
 
 #define DRAW_INIT()	{				\
 	texture = zb->current_texture;	\
+	s_mask = zb->texture_s_mask;	\
+	t_mask = zb->texture_t_mask;	\
+	s_shift = zb->texture_s_shift;	\
+	t_shift = zb->texture_t_shift;	\
 }
 
+#define TEXEL(s, t)	(*(PIXEL *)((char *)texture + (((t & t_mask) >> t_shift) | ((s & s_mask) >> s_shift)) * 3))
+
 #define PUT_PIXEL(_a) {						\
 	zz = z >> ZB_POINT_Z_FRAC_BITS;			\
 	if ((ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {	\
-		pp[_a] = texture[((t & 0x3FC00000) | s) >> 14];	\
+		pp[_a] = TEXEL(s, t);				\
 		pz_2[_a] = z;						\
 	}										\
 	z += dzdx;								\
@@ -116,11 +164,34 @@ void ZB_fillTriangleMapping(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBu
 	t += dtdx;								\
 }
 
+#define PUT_PIXELS8() {								\
+	int mask = ZB_depthTestSpan8(pz, pz_2, z, dzdx);	\
+	if (mask) {										\
+		for (int _a = 0; _a < 8; _a++) {			\
+			if (mask & (1 << _a)) {					\
+				pp[_a] = TEXEL(s, t);				\
+				pz_2[_a] = z;						\
+			}										\
+			z += dzdx;								\
+			s += dsdx;								\
+			t += dtdx;								\
+		}											\
+	} else {										\
+		z += 8 * (unsigned int)dzdx;				\
+		s += 8 * (unsigned int)dsdx;				\
+		t += 8 * (unsigned int)dtdx;				\
+	}												\
+}
+
 #include "graphics/tinygl/ztriangle.h"
+
+#undef TEXEL
 }
 
 void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2) {
 	PIXEL *texture;
+	unsigned int s_mask, t_mask;
+	int s_shift, t_shift;
 	float fdzdx, fndzdx, ndszdx, ndtzdx;
 	int _drgbdx;
 
@@ -133,7 +204,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	PIXEL *pp1;
 	int part, update_left, update_right;
 
-	int nb_lines, dx1, dy1, tmp, dx2, dy2;
+	int nb_lines, dx1, dy1, tmp, dx2, dy2, cur_y;
 
 	int error = 0, derror = 0;
 	int x1 = 0, dxdy_min = 0, dxdy_max = 0;
@@ -234,6 +305,10 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	pz2 = zb->zbuf2 + p0->y * zb->xsize;
 
 	texture = zb->current_texture;
+	s_mask = zb->texture_s_mask;
+	t_mask = zb->texture_t_mask;
+	s_shift = zb->texture_s_shift;
+	t_shift = zb->texture_t_shift;
 	fdzdx = (float)dzdx;
 	fndzdx = NB_INTERP * fdzdx;
 	ndszdx = NB_INTERP * dszdx;
@@ -242,6 +317,8 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 	_drgbdx |= (dgdx / (1 << 5)) & 0x000007FF;
 	_drgbdx |= ((dbdx / (1 << 7)) << 12) & 0x001FF000;
 
+	cur_y = p0->y;
+
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz0 > 0) {
@@ -328,11 +405,36 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 			x2 = pr1->x << 16;
 		}
 
+		// go straight to the first scanline of the band
+		if (cur_y < zb->band_ymin && nb_lines > 0) {
+			int skip = zb->band_ymin - cur_y;
+			int nb_max;
+			if (skip > nb_lines)
+				skip = nb_lines;
+			nb_max = ZB_skipEdgeLines(&error, derror, skip);
+			x1 += skip * dxdy_min + nb_max;
+			z1 += skip * dzdl_min + nb_max * dzdx;
+			r1 += skip * drdl_min + nb_max * drdx;
+			g1 += skip * dgdl_min + nb_max * dgdx;
+			b1 += skip * dbdl_min + nb_max * dbdx;
+			sz1 += skip * dszdl_min + nb_max * dszdx;
+			tz1 += skip * dtzdl_min + nb_max * dtzdx;
+			x2 += skip * dx2dy2;
+			pp1 = (PIXEL *)((char *)pp1 + skip * zb->linesize);
+			pz1 += skip * zb->xsize;
+			pz2 += skip * zb->xsize;
+			cur_y += skip;
+			nb_lines -= skip;
+		}
+
 		// we draw all the scan line of the part
 
 		while (nb_lines > 0) {
 			nb_lines--;
-			{
+			// only the scanlines of the current tile are drawn
+			if (cur_y >= zb->band_ymax)
+				return;
+			if (cur_y >= zb->band_ymin) {
 				register unsigned short *pz;
 				register unsigned int *pz_2;
 				register PIXEL *pp;
@@ -364,35 +466,47 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 						fz += fndzdx;
 						zinv = (float)(1.0 / fz);
 					}
-					for (int _a = 0; _a < 8; _a++) {
-						zz = z >> ZB_POINT_Z_FRAC_BITS;
-						if ((ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {
-							unsigned ttt = (t & 0x003FC000) >> (9 - PSZSH);
-							unsigned sss = (s & 0x003FC000) >> (17 - PSZSH);
-							char *ptr = (char *)(texture) + (((ttt | sss) >> 1) * 3);
-							PIXEL pixel = *(PIXEL *)ptr;
-							char alpha = *(ptr + 2);
-							if (alpha == '\xff') {
-								tmp = rgb & 0xF81F07E0;
-								unsigned int light = tmp | (tmp >> 16);
-								unsigned int c_r = (pixel & 0xF800) >> 8;
-								unsigned int c_g = (pixel & 0x07E0) >> 3;
-								unsigned int c_b = (pixel & 0x001F) << 3;
-								unsigned int l_r = (light & 0xF800) >> 8;
-								unsigned int l_g = (light & 0x07E0) >> 3;
-								unsigned int l_b = (light & 0x001F) << 3;
-								c_r = (c_r * l_r) / 256;
-								c_g = (c_g * l_g) / 256;
-								c_b = (c_b * l_b) / 256;
-								pixel = ((c_r & 0xF8) << 8) | ((c_g & 0xFC) << 3) | (c_b >> 3);
-								pp[_a] = pixel;
-								pz_2[_a] = z;
+					int mask = 0xff;
+#ifdef ZB_SIMD_SPANS
+					if (zb->simd_spans)
+						mask = ZB_depthTestSpan8(pz, pz_2, z, dzdx);
+#endif
+					if (mask) {
+						for (int _a = 0; _a < 8; _a++) {
+							zz = z >> ZB_POINT_Z_FRAC_BITS;
+							if ((mask & (1 << _a)) && (ZCMP(zz, pz[_a])) && (ZCMP(z, pz_2[_a]))) {
+								unsigned ttt = (t & t_mask) >> t_shift;
+								unsigned sss = (s & s_mask) >> s_shift;
+								char *ptr = (char *)(texture) + ((ttt | sss) * 3);
+								PIXEL pixel = *(PIXEL *)ptr;
+								char alpha = *(ptr + 2);
+								if (alpha == '\xff') {
+									tmp = rgb & 0xF81F07E0;
+									unsigned int light = tmp | (tmp >> 16);
+									unsigned int c_r = (pixel & 0xF800) >> 8;
+									unsigned int c_g = (pixel & 0x07E0) >> 3;
+									unsigned int c_b = (pixel & 0x001F) << 3;
+									unsigned int l_r = (light & 0xF800) >> 8;
+									unsigned int l_g = (light & 0x07E0) >> 3;
+									unsigned int l_b = (light & 0x001F) << 3;
+									c_r = (c_r * l_r) / 256;
+									c_g = (c_g * l_g) / 256;
+									c_b = (c_b * l_b) / 256;
+									pixel = ((c_r & 0xF8) << 8) | ((c_g & 0xFC) << 3) | (c_b >> 3);
+									pp[_a] = pixel;
+									pz_2[_a] = z;
+								}
 							}
+							z += dzdx;
+							s += dsdx;
+							t += dtdx;
+							rgb = (rgb + drgbdx) & (~0x00200800);
 						}
-						z += dzdx;
-						s += dsdx;
-						t += dtdx;
-						rgb = (rgb + drgbdx) & (~0x00200800);
+					} else {
+						// s and t restart from sz and tz on the next group
+						z += NB_INTERP * (unsigned int)dzdx;
+						for (int _a = 0; _a < NB_INTERP; _a++)
+							rgb = (rgb + drgbdx) & (~0x00200800);
 					}
 
 					pz += NB_INTERP;
@@ -417,9 +531,9 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 					{
 						zz = z >> ZB_POINT_Z_FRAC_BITS;
 						if ((ZCMP(zz, pz[0])) && (ZCMP(z, pz_2[0]))) {
-							unsigned ttt = (t & 0x003FC000) >> (9 - PSZSH);
-							unsigned sss = (s & 0x003FC000) >> (17 - PSZSH);
-							char *ptr = (char *)(texture) + (((ttt | sss) >> 1) * 3);
+							unsigned ttt = (t & t_mask) >> t_shift;
+							unsigned sss = (s & s_mask) >> s_shift;
+							char *ptr = (char *)(texture) + ((ttt | sss) * 3);
 							PIXEL pixel = *(PIXEL *)ptr;
 							char alpha = *(ptr + 2);
 							if (alpha == '\xff') {
@@ -485,6 +599,7 @@ void ZB_fillTriangleMappingPerspective(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoi
 			pp1 = (PIXEL *)((char *)pp1 + zb->linesize);
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
+			cur_y++;
 		}
 	}
 }
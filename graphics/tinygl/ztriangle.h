@@ -9,7 +9,7 @@
 	PIXEL *pp1;
 	int part, update_left, update_right;
 
-	int nb_lines, dx1, dy1, tmp, dx2, dy2;
+	int nb_lines, dx1, dy1, tmp, dx2, dy2, cur_y;
 
 	int error = 0, derror = 0;
 	int x1 = 0, dxdy_min = 0, dxdy_max = 0;
@@ -138,6 +138,8 @@
 
 	DRAW_INIT();
 
+	cur_y = p0->y;
+
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz > 0) {
@@ -237,13 +239,48 @@
 			x2 = pr1->x << 16;
 		}
 
+		// go straight to the first scanline of the band
+		if (cur_y < zb->band_ymin && nb_lines > 0) {
+			int skip = zb->band_ymin - cur_y;
+			int nb_max;
+			if (skip > nb_lines)
+				skip = nb_lines;
+			nb_max = ZB_skipEdgeLines(&error, derror, skip);
+			x1 += skip * dxdy_min + nb_max;
+#ifdef INTERP_Z
+			z1 += skip * dzdl_min + nb_max * dzdx;
+#endif
+#ifdef INTERP_RGB
+			r1 += skip * drdl_min + nb_max * drdx;
+			g1 += skip * dgdl_min + nb_max * dgdx;
+			b1 += skip * dbdl_min + nb_max * dbdx;
+#endif
+#ifdef INTERP_ST
+			s1 += skip * dsdl_min + nb_max * dsdx;
+			t1 += skip * dtdl_min + nb_max * dtdx;
+#endif
+#ifdef INTERP_STZ
+			sz1 += skip * dszdl_min + nb_max * dszdx;
+			tz1 += skip * dtzdl_min + nb_max * dtzdx;
+#endif
+			x2 += skip * dx2dy2;
+			pp1 = (PIXEL *)((char *)pp1 + skip * zb->linesize);
+			pz1 += skip * zb->xsize;
+			pz2 += skip * zb->xsize;
+			cur_y += skip;
+			nb_lines -= skip;
+		}
+
 		// we draw all the scan line of the part
 
 		while (nb_lines>0) {
 			nb_lines--;
+			// only the scanlines of the current tile are drawn
+			if (cur_y >= zb->band_ymax)
+				return;
 #ifndef DRAW_LINE
 			// generic draw line
-			{
+			if (cur_y >= zb->band_ymin) {
 				register PIXEL *pp;
 				register int n;
 #ifdef INTERP_Z
@@ -280,6 +317,9 @@
 #ifdef INTERP_STZ
 				sz = sz1;
 				tz = tz1;
+#endif
+#ifdef PUT_PIXELS8
+				DRAW_SPANS8();
 #endif
 				while (n >= 3) {
 					PUT_PIXEL(0);
@@ -304,7 +344,8 @@
 				}
 			}
 #else
-			DRAW_LINE();
+			if (cur_y >= zb->band_ymin)
+				DRAW_LINE();
 #endif
       
 			// left edge
@@ -355,6 +396,7 @@
 			pp1 = (PIXEL *)((char *)pp1 + zb->linesize);
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
+			cur_y++;
 		}
 	}
 }
@@ -367,3 +409,4 @@
 #undef DRAW_INIT
 #undef DRAW_LINE  
 #undef PUT_PIXEL
+#undef PUT_PIXELS8
@@ -1,5 +1,6 @@
 
 #include "graphics/tinygl/zbuffer.h"
+#include "graphics/tinygl/zspan.h"
 
 namespace TinyGL {
 
@@ -11,7 +12,7 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 	unsigned char *pm1;
 	int part, update_left, update_right;
 
-	int nb_lines, dx1, dy1, tmp, dx2, dy2;
+	int nb_lines, dx1, dy1, tmp, dx2, dy2, cur_y;
 
 	int error = 0, derror = 0;
 	int x1 = 0, dxdy_min = 0, dxdy_max = 0;
@@ -57,6 +58,8 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 
 	pm1 = zb->shadow_mask_buf + zb->xsize * p0->y;
 
+	cur_y = p0->y;
+
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz > 0) {
@@ -118,11 +121,28 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 			x2 = pr1->x << 16;
 		}
 
+		// go straight to the first scanline of the band
+		if (cur_y < zb->band_ymin && nb_lines > 0) {
+			int skip = zb->band_ymin - cur_y;
+			int nb_max;
+			if (skip > nb_lines)
+				skip = nb_lines;
+			nb_max = ZB_skipEdgeLines(&error, derror, skip);
+			x1 += skip * dxdy_min + nb_max;
+			x2 += skip * dx2dy2;
+			pm1 += skip * zb->xsize;
+			cur_y += skip;
+			nb_lines -= skip;
+		}
+
 		// we draw all the scan line of the part
 		while (nb_lines > 0) {
 			nb_lines--;
+			// only the scanlines of the current tile are drawn
+			if (cur_y >= zb->band_ymax)
+				return;
 			// generic draw line
-			{
+			if (cur_y >= zb->band_ymin) {
 				register unsigned char *pm;
 				register int n;
 
@@ -156,6 +176,7 @@ void ZB_fillTriangleFlatShadowMask(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *
 
 			// screen coordinates
 			pm1 = pm1 + zb->xsize;
+			cur_y++;
 		}
 	}
 }
@@ -170,7 +191,7 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 	PIXEL *pp1;
 	int part, update_left, update_right;
 
-	int nb_lines, dx1, dy1, tmp, dx2, dy2;
+	int nb_lines, dx1, dy1, tmp, dx2, dy2, cur_y;
 
 	int error = 0, derror = 0;
 	int x1 = 0, dxdy_min = 0, dxdy_max = 0;
@@ -228,6 +249,8 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 
 	color = RGB_TO_PIXEL(zb->shadow_color_r, zb->shadow_color_g, zb->shadow_color_b);
 
+	cur_y = p0->y;
+
 	for (part = 0; part < 2; part++) {
 		if (part == 0) {
 			if (fz > 0) {
@@ -294,12 +317,33 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 			x2 = pr1->x << 16;
 		}
 
+		// go straight to the first scanline of the band
+		if (cur_y < zb->band_ymin && nb_lines > 0) {
+			int skip = zb->band_ymin - cur_y;
+			int nb_max;
+			if (skip > nb_lines)
+				skip = nb_lines;
+			nb_max = ZB_skipEdgeLines(&error, derror, skip);
+			x1 += skip * dxdy_min + nb_max;
+			z1 += skip * dzdl_min + nb_max * dzdx;
+			x2 += skip * dx2dy2;
+			pp1 = (PIXEL *)((char *)pp1 + skip * zb->linesize);
+			pz1 += skip * zb->xsize;
+			pz2 += skip * zb->xsize;
+			pm1 += skip * zb->xsize;
+			cur_y += skip;
+			nb_lines -= skip;
+		}
+
 		// we draw all the scan line of the part
 
 		while (nb_lines > 0) {
 			nb_lines--;
+			// only the scanlines of the current tile are drawn
+			if (cur_y >= zb->band_ymax)
+				return;
 			// generic draw line
-			{
+			if (cur_y >= zb->band_ymin) {
 				register PIXEL *pp;
 				register unsigned char *pm;
 				register int n;
@@ -313,6 +357,20 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 				pz = pz1 + x1;
 				pz_2 = pz2 + x1;
 				z = z1;
+#ifdef ZB_SIMD_SPANS
+				if (zb->simd_spans) {
+					while (n >= 7) {
+						// as below, the mask is sampled once every 4 pixels
+						ZB_fillSpanFlat8(pp, pz, pz_2, z, dzdx, color, (pm[0] ? 0x0f : 0) | (pm[4] ? 0xf0 : 0));
+						z += 8 * (unsigned int)dzdx;
+						pz += 8;
+						pz_2 += 8;
+						pm += 8;
+						pp = (PIXEL *)((char *)pp + 8 * PSZB);
+						n -= 8;
+					}
+				}
+#endif
 				while (n >= 3) {
 					for (int a = 0; a < 4; a++) {
 						zz = z >> ZB_POINT_Z_FRAC_BITS;
@@ -361,6 +419,7 @@ void ZB_fillTriangleFlatShadow(ZBuffer *zb, ZBufferPoint *p0, ZBufferPoint *p1,
 			pz1 += zb->xsize;
 			pz2 += zb->xsize;
 			pm1 += zb->xsize;
+			cur_y++;
 		}
 	}
 }